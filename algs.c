@@ -2,9 +2,19 @@
 #include <stdlib.h>
 
 #include "algs.h"
+#include "band.h"
+#include "structure.h"
+#include "cholesky.h"
 #include "error.h"
+#include "threads.h"
+#include "profile.h"
 
-static size_t *elimination(Matrix *a, Matrix *f, _Bool use_pivot);
+#define KERNEL_TYPE double
+#define KERNEL_ABS fabs
+#define KERNEL_SUFFIX _double
+#include "lu_kernel.h"
+
+static size_t *elimination(Matrix *a, _Bool use_pivot, Workspace *workspace);
 
 static int eq_zero(data_t d)
 {
@@ -13,149 +23,558 @@ static int eq_zero(data_t d)
 #undef eps
 }
 
-data_t calc_determinant(Matrix *a, _Bool use_pivot, int *status) {
+size_t gauss_workspace_size(size_t n, size_t rhs_cols) {
+    // Разложение: структура, копия матрицы, порядок столбцов и рабочие массивы прямого хода. Решение: копия
+    // правой части и ответ
+    return MATRIX_ALIGN_UP(sizeof(LUFactor)) + matrix_storage_size(n, n) + 2 * MATRIX_ALIGN_UP(n * sizeof(size_t)) +
+           MATRIX_ALIGN_UP(n * sizeof(_Bool)) + 2 * matrix_storage_size(n, rhs_cols);
+}
+
+LUFactor *lu_factor(Matrix *a, _Bool use_pivot, int *status) {
+    return lu_factor_ws(a, use_pivot, NULL, status);
+}
+
+LUFactor *lu_factor_ws(Matrix *a, _Bool use_pivot, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("lu_factor");
     if (a == NULL  || a->col != a->row) {
         *status = INCORRECT_ARGS;
-        return 0.0;
+        return NULL;
     }
-    if ((a = copy_matrix(a)) == NULL) { // Копия для преобразований
+    LUFactor *factor = workspace_alloc(workspace, sizeof(*factor));
+    if (factor == NULL) {
         *status = ALLOC_FAILED;
-        return 0.0;
+        return NULL;
     }
-    size_t *col_order = elimination(a, NULL, use_pivot);
-    if (col_order == NULL) {
+    factor->workspace = workspace;
+    if ((factor->lu = workspace_copy(workspace, a)) == NULL) { // Копия, в которой будут храниться множители L
+        // и матрица U
         *status = ALLOC_FAILED;
-        free_matrix(a);
-        return 0.0;
+        workspace_free(workspace, factor);
+        return NULL;
+    }
+    if ((factor->col_order = elimination(factor->lu, use_pivot, workspace)) == NULL) { // Прямой ход выполняется
+        // один раз
+        *status = ALLOC_FAILED;
+        free_matrix(factor->lu);
+        workspace_free(workspace, factor);
+        return NULL;
+    }
+
+    *status = OK;
+    return factor;
+}
+
+void free_lu_factor(LUFactor *factor) {
+    if (factor == NULL) {
+        return;
     }
+    workspace_free(factor->workspace, factor->col_order);
+    free_matrix(factor->lu);
+    workspace_free(factor->workspace, factor);
+}
 
+data_t lu_determinant(LUFactor *factor) {
+    PROFILE_BEGIN("lu_determinant");
+    Matrix *lu = factor->lu;
+    size_t *col_order = factor->col_order;
     data_t det = 1.0;
-    for (size_t i = 0; i < a->row; i++) {
-        det *= get_element(a, i, col_order[i]); // Перемножаем диагональные с точности до перестановки столбцов элементы
+    for (size_t i = 0; i < lu->row; i++) {
+        det *= get_element(lu, i, col_order[i]); // Перемножаем диагональные с точности до перестановки столбцов элементы
         for (size_t j = 0; j < i; j++) { // Домножаем на (-1)^(количество инверсий)
             if (col_order[j] > col_order[i]) {
                 det *= -1.0;
             }
         }
     }
-
-    *status = OK;
-    free(col_order);
-    free_matrix(a);
     return det;
 }
 
-Matrix *gauss_solve(Matrix *a, Matrix *f, _Bool use_pivot, int *status) {
-    if (a == NULL  || a->col != a->row || f == NULL) {
+static void forward_substitution(LUFactor *factor, Matrix *f);
+static void back_substitution(LUFactor *factor, Matrix *f, Matrix *answ);
+
+Matrix *lu_solve(LUFactor *factor, Matrix *f, int *status) {
+    return lu_solve_ws(factor, f, NULL, status);
+}
+
+Matrix *lu_solve_ws(LUFactor *factor, Matrix *f, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("lu_solve");
+    if (factor == NULL || f == NULL || f->row != factor->lu->row) {
         *status = INCORRECT_ARGS;
         return NULL;
     }
-    if ((a = copy_matrix(a)) == NULL) { // Копии для преобразований
+    if ((f = workspace_copy(workspace, f)) == NULL) { // Копия для преобразований
         *status = ALLOC_FAILED;
         return NULL;
     }
-    if ((f = copy_matrix(f)) == NULL) {
+    Matrix *answ = workspace_matrix(workspace, f->row, f->col);
+    if (answ == NULL) {
         *status = ALLOC_FAILED;
-        free_matrix(a);
+        free_matrix(f);
         return NULL;
     }
 
-    size_t *col_order = elimination(a, f, use_pivot); // Выполняем прямой ход метода Гаусса
-    if (col_order == NULL) {
+    forward_substitution(factor, f); // Повторяем над столбцами свободных членов преобразования прямого хода
+    back_substitution(factor, f, answ);
+
+    *status = OK;
+    free_matrix(f);
+    return answ;
+}
+
+Matrix *lu_inverse(LUFactor *factor, int *status) {
+    return lu_inverse_ws(factor, NULL, status);
+}
+
+Matrix *lu_inverse_ws(LUFactor *factor, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("lu_inverse");
+    if (factor == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    // Столбцы обратной матрицы -- решения систем с правыми частями, равными столбцам единичной матрицы
+    Matrix *e = workspace_matrix(workspace, factor->lu->row, factor->lu->col);
+    if (e == NULL) {
         *status = ALLOC_FAILED;
-        free_matrix(a);
-        free_matrix(f);
         return NULL;
     }
-    Matrix *answ = new_matrix(f->row, 1);
-    if (answ == NULL) {
+    for (size_t i = 0; i < e->row; i++) {
+        set_element(e, i, i, 1.0);
+    }
+    Matrix *res = workspace_matrix(workspace, e->row, e->col);
+    if (res == NULL) {
         *status = ALLOC_FAILED;
-        free(col_order);
-        free_matrix(a);
-        free_matrix(f);
+        free_matrix(e);
         return NULL;
     }
 
-    // Обратный ход метода Гаусса
-    for (size_t i = a->row; i > 0; i--) {
-        data_t acc = get_element(f, i - 1, 0); // Находим сумму для всех найденных неизвестных и свободного члена
-        for (size_t j = i; j < a->col; j++) {
-            size_t col = col_order[j];
-            acc -= get_element(a, i - 1, col) * get_element(answ, col, 0);
+    forward_substitution(factor, e);
+    back_substitution(factor, e, res);
+
+    *status = OK;
+    free_matrix(e);
+    return res;
+}
+
+data_t calc_determinant(Matrix *a, _Bool use_pivot, int *status) {
+    return calc_determinant_ws(a, use_pivot, NULL, status);
+}
+
+data_t calc_determinant_ws(Matrix *a, _Bool use_pivot, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("calc_determinant");
+    LUFactor *factor = lu_factor_ws(a, use_pivot, workspace, status);
+    if (factor == NULL) {
+        return 0.0;
+    }
+    data_t det = lu_determinant(factor);
+    free_lu_factor(factor);
+    return det;
+}
+
+Matrix *gauss_solve(Matrix *a, Matrix *f, _Bool use_pivot, int *status) {
+    // Для диагональных, трёхдиагональных, ленточных и треугольных матриц полное разложение не требуется. В области
+    // памяти (gauss_solve_ws) всегда выполняется LU-разложение, т.к. её размер рассчитан на него
+    MatrixStructure structure = detect_structure(a);
+    if (structure.type != STRUCTURE_DENSE && f != NULL) {
+        return structured_solve(a, f, &structure, status);
+    }
+    // Симметричные положительно определённые матрицы раскладываются вдвое быстрее по Холецкому. Разложение
+    // L * D * L^T без выбора главного элемента не используется: для знаконеопределённых матриц рост элементов
+    // не ограничен, поэтому они, как и матрицы при use_pivot, раскладываются LU-разложением
+    if (f != NULL && !use_pivot && is_symmetric(a)) {
+        CholeskyFactor *factor = cholesky_factor_positive(a, status);
+        if (factor != NULL) {
+            Matrix *answ = cholesky_solve(factor, f, status);
+            free_cholesky_factor(factor);
+            return answ;
+        }
+        if (*status == ALLOC_FAILED) {
+            return NULL;
         }
-        // Вычисляем неизвестную и записываем в вектор-столбец ответа
-        set_element(answ, col_order[i - 1], 0, acc / get_element(a, i - 1, col_order[i - 1]));
     }
+    return gauss_solve_ws(a, f, use_pivot, NULL, status);
+}
 
-    free_matrix(a);
-    free_matrix(f);
+Matrix *gauss_solve_ws(Matrix *a, Matrix *f, _Bool use_pivot, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("gauss_solve");
+    if (f == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    LUFactor *factor = lu_factor_ws(a, use_pivot, workspace, status);
+    if (factor == NULL) {
+        return NULL;
+    }
+    Matrix *answ = lu_solve_ws(factor, f, workspace, status);
+    free_lu_factor(factor);
     return answ;
 }
 
-Matrix *calc_inverse(Matrix *a, int *status) {
-    if (a == NULL  || a->col != a->row) {
+Matrix *sparse_gauss_solve(SparseMatrix *a, Matrix *f, int *status) {
+    PROFILE_BEGIN("sparse_gauss_solve");
+    if (a == NULL || a->col != a->row || f == NULL || f->row != a->row) {
         *status = INCORRECT_ARGS;
         return NULL;
     }
-    if ((a = copy_matrix(a)) == NULL) { // Копия для преобразований
-        *status = ALLOC_FAILED;
+    // Симметричная перестановка Катхилла-Макки сужает ленту, после чего разложение выполняется в ленточном
+    // формате: заполнение при исключении не выходит за пределы ленты
+    size_t *order = sparse_rcm_order(a, status);
+    if (order == NULL) {
         return NULL;
     }
-    // Создаём присоединёную единичную матрицу
-    Matrix *res = new_matrix(a->row, a->col);
-    if (res == NULL) {
+    size_t *position = malloc((a->row != 0 ? a->row : 1) * sizeof(*position));
+    if (position == NULL) {
         *status = ALLOC_FAILED;
-        free_matrix(a);
+        free(order);
         return NULL;
     }
     for (size_t i = 0; i < a->row; i++) {
-        set_element(res, i, i, 1.0);
+        position[order[i]] = i;
+    }
+    size_t lower = 0, upper = 0;
+    for (size_t i = 0; i < a->row; i++) {
+        for (size_t k = a->row_start[i]; k < a->row_start[i + 1]; k++) {
+            size_t row = position[i], col = position[a->col_idx[k]];
+            if (row > col && row - col > lower) {
+                lower = row - col;
+            }
+            if (col > row && col - row > upper) {
+                upper = col - row;
+            }
+        }
     }
 
-    // В силу того, что алгоритм прямого хода метода Гаусса в функции elimination использует фиктивную перестановку
-    // столбцов он не слишком удобен для нахождения обратной матрицы и не даёт выигрыша в производительности,
-    // потому используется другая реализация прямого хода
+    BandMatrix *band = new_band_matrix(a->row, lower, upper);
+    Matrix *answ = new_matrix(f->row, f->col);
+    if (band == NULL || answ == NULL) {
+        *status = ALLOC_FAILED;
+        free_band_matrix(band);
+        free_matrix(answ);
+        free(position);
+        free(order);
+        return NULL;
+    }
     for (size_t i = 0; i < a->row; i++) {
-        if (eq_zero(get_element(a, i, i))) { // Диагональный элемент необходимо выбрать ненулевым
-            for (size_t j = i + 1; j < a->row; j++) {
-                if (!eq_zero(get_element(a, j, i))) { // Находим строку с ненулевым элементом
-                    swap_row(a, i, j); // Меняем текущую строку с найденной в обеих матрицах
-                    swap_row(res, i, j);
-                }
+        for (size_t k = a->row_start[i]; k < a->row_start[i + 1]; k++) {
+            set_band_element(band, position[i], position[a->col_idx[k]], a->values[k]);
+        }
+        for (size_t j = 0; j < f->col; j++) { // Правая часть переставляется так же, как строки
+            set_element(answ, position[i], j, get_element(f, i, j));
+        }
+    }
+
+    band_factor(band);
+    band_solve(band, answ);
+
+    // Возвращаем неизвестные в исходный порядок
+    Matrix *res = new_matrix(f->row, f->col);
+    if (res == NULL) {
+        *status = ALLOC_FAILED;
+    } else {
+        for (size_t i = 0; i < a->row; i++) {
+            for (size_t j = 0; j < f->col; j++) {
+                set_element(res, order[i], j, get_element(answ, i, j));
             }
         }
-        mul_row(res, i, 1.0 / get_element(a, i, i)); // Делим строку обеих матриц на диагональный элемент
-        mul_row(a, i, 1.0 / get_element(a, i, i));
-        for (size_t j = i + 1; j < a->row; j++) {
-            mul_sub_row(res, i, j, -get_element(a, j, i)); // Вычитаем из всех последующих строк обеих матриц данную
-            mul_sub_row(a, i, j, -get_element(a, j, i)); // домноженную на необходимый коэффициент
+        *status = OK;
+    }
+    free_matrix(answ);
+    free_band_matrix(band);
+    free(position);
+    free(order);
+    return res;
+}
+
+static void forward_substitution(LUFactor *factor, Matrix *f)
+{
+    PROFILE_BEGIN("forward_substitution");
+    Matrix *lu = factor->lu;
+    PROFILE_COUNT(lu->row * (lu->row - 1) * f->col, 0, 0);
+    for (size_t i = 0; i < lu->row; i++) {
+        PARALLEL_FOR(num_threads(get_thread_count()) if((lu->row - i) * f->col > PARALLEL_THRESHOLD) schedule(static))
+        for (size_t j = i + 1; j < lu->row; j++) { // Множители хранятся на месте занулённых элементов
+            mul_sub_row(f, i, j, get_element(lu, j, factor->col_order[i]));
         }
     }
+}
+
+// Число правых частей, обрабатываемых обратным ходом вместе: строки U читаются один раз на блок, а не на каждый
+// столбец, и части строк ответа из блока помещаются в кэш первого уровня
+#define RHS_BLOCK 64
 
-    // Обратный ход, вычитаем из всех предыдущих строк обеих матриц текущую, домноженную на необходимый коэффициент
-    for (size_t i = a->row; i > 0; i--) {
-        for (size_t j = i - 1; j > 0; j--) {
-            mul_sub_row(res, i - 1, j - 1, -get_element(a, j - 1, i - 1));
-            mul_sub_row(a, i - 1, j - 1, -get_element(a, j - 1, i - 1));
+// Обратный ход для столбцов begin..end сразу: из строки ответа вычитаются строки найденных неизвестных, умноженные
+// на элемент U, поэтому внутренний цикл идёт по соседним элементам строки и векторизуется
+static void back_substitution_block(LUFactor *factor, Matrix *f, Matrix *answ, size_t begin, size_t end)
+{
+    Matrix *lu = factor->lu;
+    size_t *col_order = factor->col_order;
+    for (size_t i = lu->row; i > 0; i--) {
+        data_t *acc = answ->values + col_order[i - 1] * answ->stride;
+        const data_t *rhs = f->values + (i - 1) * f->stride;
+        for (size_t k = begin; k < end; k++) {
+            acc[k] = rhs[k];
+        }
+        for (size_t j = i; j < lu->col; j++) {
+            data_t element = get_element(lu, i - 1, col_order[j]);
+            const data_t *known = answ->values + col_order[j] * answ->stride;
+            for (size_t k = begin; k < end; k++) {
+                acc[k] -= element * known[k];
+            }
+        }
+        data_t pivot = get_element(lu, i - 1, col_order[i - 1]);
+        for (size_t k = begin; k < end; k++) {
+            acc[k] /= pivot;
         }
     }
+}
 
-    *status = OK;
-    free_matrix(a);
-    return res;
+static void back_substitution(LUFactor *factor, Matrix *f, Matrix *answ)
+{
+    PROFILE_BEGIN("back_substitution");
+    Matrix *lu = factor->lu;
+    PROFILE_COUNT(lu->row * lu->row * f->col, 0, 0);
+    size_t *col_order = factor->col_order;
+    if (f->col > 1) { // Блоки столбцов независимы и распределяются по потокам
+        size_t blocks = (f->col + RHS_BLOCK - 1) / RHS_BLOCK;
+        PARALLEL_FOR(num_threads(get_thread_count()) if(f->col * lu->row * lu->row / 2 > PARALLEL_THRESHOLD) \
+                     schedule(static))
+        for (size_t b = 0; b < blocks; b++) {
+            size_t end = (b + 1) * RHS_BLOCK < f->col ? (b + 1) * RHS_BLOCK : f->col;
+            back_substitution_block(factor, f, answ, b * RHS_BLOCK, end);
+        }
+        return;
+    }
+    // Для единственного столбца параллельно вычисляется сумма в каждой строке
+    for (size_t k = 0; k < f->col; k++) {
+        for (size_t i = lu->row; i > 0; i--) {
+            data_t acc = get_element(f, i - 1, k); // Находим сумму для всех найденных неизвестных и свободного члена
+            PARALLEL_FOR(num_threads(get_thread_count()) if(lu->col - i > PARALLEL_THRESHOLD) reduction(+:acc) \
+                         schedule(static))
+            for (size_t j = i; j < lu->col; j++) {
+                size_t col = col_order[j];
+                acc -= get_element(lu, i - 1, col) * get_element(answ, col, k);
+            }
+            // Вычисляем неизвестную и записываем в вектор-столбец ответа
+            set_element(answ, col_order[i - 1], k, acc / get_element(lu, i - 1, col_order[i - 1]));
+        }
+    }
 }
 
-data_t matrix_norm(Matrix *a);
+static void transposed_solve(LUFactor *factor, Matrix *f, Matrix *answ)
+{
+    PROFILE_BEGIN("transposed_solve");
+    PROFILE_COUNT(2 * factor->lu->row * factor->lu->row, 0, 0);
+    // A = L * U * Q^T, где Q -- перестановка столбцов, поэтому A^T * x = f сводится к U^T * w = Q^T * f и L^T * x = w
+    Matrix *lu = factor->lu;
+    size_t *col_order = factor->col_order;
+    for (size_t k = 0; k < lu->row; k++) {
+        data_t acc = get_element(f, col_order[k], 0);
+        for (size_t m = 0; m < k; m++) {
+            acc -= get_element(lu, m, col_order[k]) * get_element(answ, m, 0);
+        }
+        set_element(answ, k, 0, acc / get_element(lu, k, col_order[k]));
+    }
+    for (size_t i = lu->row; i > 0; i--) { // Множители хранятся с обратным знаком
+        data_t acc = get_element(answ, i - 1, 0);
+        for (size_t j = i; j < lu->row; j++) {
+            acc += get_element(lu, j, col_order[i - 1]) * get_element(answ, j, 0);
+        }
+        set_element(answ, i - 1, 0, acc);
+    }
+}
 
-data_t calc_condition_number(Matrix *a, int *status)
+Matrix *calc_inverse(Matrix *a, int *status) {
+    return calc_inverse_ws(a, NULL, status);
+}
+
+// Обращение треугольных сомножителей разложения. Строка i матрицы U^-1 -- решение x * U = e_i, строка i матрицы
+// L^-1 -- решение y * L = e_i: системы независимы и решаются разными потоками, а вычитаются в них целые строки
+// разложения, поэтому обращение к памяти последовательное
+static void invert_triangular(Matrix *lu, Matrix *upper, Matrix *lower)
 {
+    PROFILE_BEGIN("invert_triangular");
+    PROFILE_COUNT(2 * lu->row * lu->row * lu->row / 3, 0, 0);
+    size_t n = lu->row;
+    // Работа над строкой i пропорциональна (n - i)^2 или i^2, циклическое распределение выравнивает нагрузку
+    PARALLEL_FOR(num_threads(get_thread_count()) if(n * n * n / 3 > PARALLEL_THRESHOLD) schedule(static, 1))
+    for (size_t i = 0; i < n; i++) {
+        data_t *x = upper->values + i * upper->stride;
+        x[i] = 1.0;
+        for (size_t k = i; k < n; k++) {
+            const data_t *u = lu->values + k * lu->stride;
+            data_t coefficient = x[k] / u[k];
+            x[k] = coefficient;
+            for (size_t j = k + 1; j < n; j++) {
+                x[j] -= coefficient * u[j];
+            }
+        }
+        data_t *y = lower->values + i * lower->stride;
+        y[i] = 1.0;
+        for (size_t k = i; k > 0; k--) { // Диагональ L единичная
+            const data_t *l = lu->values + k * lu->stride;
+            data_t coefficient = y[k];
+            for (size_t j = 0; j < k; j++) {
+                y[j] -= coefficient * l[j];
+            }
+        }
+    }
+}
+
+Matrix *calc_inverse_ws(Matrix *a, Workspace *workspace, int *status) {
+    PROFILE_BEGIN("calc_inverse");
+    if (a == NULL  || a->col != a->row) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    // Разложение с выбором главного элемента по столбцу и перестановкой строк хранит строки непрерывно, в отличие
+    // от lu_factor, где столбцы переставляются фиктивно. P * A = L * U, поэтому A^-1 = U^-1 * L^-1 * P
+    size_t n = a->row;
+    Matrix *lu = workspace_copy(workspace, a);
+    size_t *pivots = workspace_alloc(workspace, (n != 0 ? n : 1) * sizeof(*pivots));
+    Matrix *upper = workspace_matrix(workspace, n, n);
+    Matrix *lower = workspace_matrix(workspace, n, n);
+    if (lu == NULL || pivots == NULL || upper == NULL || lower == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(lower);
+        free_matrix(upper);
+        workspace_free(workspace, pivots);
+        free_matrix(lu);
+        return NULL;
+    }
+
+    Matrix *res = NULL;
+    *status = INCORRECT_ARGS; // Вырожденная матрица
+    if (lu_kernel_factor_double(lu->values, n, lu->stride, pivots)) {
+        invert_triangular(lu, upper, lower);
+        if ((res = matrix_mul_triangular(upper, lower, workspace)) == NULL) {
+            *status = ALLOC_FAILED;
+        } else {
+            // Умножение на P справа переставляет столбцы в обратном порядке перестановок строк
+            for (size_t i = n; i > 0; i--) {
+                if (pivots[i - 1] == i - 1) {
+                    continue;
+                }
+                for (size_t j = 0; j < n; j++) {
+                    data_t tmp = get_element(res, j, i - 1);
+                    set_element(res, j, i - 1, get_element(res, j, pivots[i - 1]));
+                    set_element(res, j, pivots[i - 1], tmp);
+                }
+            }
+            *status = OK;
+        }
+    }
+    free_matrix(lower);
+    free_matrix(upper);
+    workspace_free(workspace, pivots);
+    free_matrix(lu);
+    return res;
+}
+
+data_t calc_condition_number(Matrix *a, _Bool exact, int *status)
+{
+    PROFILE_BEGIN("calc_condition_number");
+    if (a == NULL  || a->col != a->row) {
+        *status = INCORRECT_ARGS;
+        return 0.0;
+    }
+    if (!exact) { // Оценка по LU-разложению не требует вычисления обратной матрицы
+        LUFactor *factor = lu_factor(a, 1, status);
+        if (factor == NULL) {
+            return 0.0;
+        }
+        data_t condition_number = lu_condition_number(factor, a, status);
+        free_lu_factor(factor);
+        return condition_number;
+    }
+
     // Вычисляем число обусловленности как ||A|| * ||A^-1||
     data_t norm = matrix_norm(a);
     Matrix *inverse = calc_inverse(a, status);
     if (*status != OK) { // Не удалось вычислить обратную матрицу
         return 0.0;
     }
-    return norm * matrix_norm(inverse);
+    data_t condition_number = norm * matrix_norm(inverse);
+    free_matrix(inverse);
+    return condition_number;
+}
+
+static void transposed_solve(LUFactor *factor, Matrix *f, Matrix *answ);
+
+data_t lu_condition_number(LUFactor *factor, Matrix *a, int *status) {
+    PROFILE_BEGIN("lu_condition_number");
+    if (factor == NULL || a == NULL || a->row != factor->lu->row || a->col != factor->lu->col) {
+        *status = INCORRECT_ARGS;
+        return 0.0;
+    }
+    size_t n = a->row;
+    Matrix *x = new_matrix(n, 1);
+    Matrix *y = new_matrix(n, 1);
+    Matrix *tmp = new_matrix(n, 1);
+    if (x == NULL || y == NULL || tmp == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(x);
+        free_matrix(y);
+        free_matrix(tmp);
+        return 0.0;
+    }
+
+    // Оценка Хейгера-Хайэма: ||A^-1||_l = ||A^-T||_1, а 1-норма матрицы B = A^-T оценивается максимумом |B * x|_1
+    // по вершинам единичного шара, к которым ведёт градиент B^T * sign(B * x). Каждый шаг стоит двух решений
+    // систем по готовому разложению, т.е. O(n^2)
+    for (size_t i = 0; i < n; i++) {
+        set_element(x, i, 0, 1.0 / n);
+    }
+    data_t estimate = 0.0;
+    size_t last_idx = n;
+    for (int step = 0; step < 5; step++) {
+        transposed_solve(factor, x, y); // y = B * x
+        estimate = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            estimate += fabs(get_element(y, i, 0));
+            set_element(tmp, i, 0, get_element(y, i, 0) < 0.0 ? -1.0 : 1.0);
+        }
+        forward_substitution(factor, tmp); // z = B^T * sign(y)
+        back_substitution(factor, tmp, y);
+
+        size_t max_idx = 0;
+        data_t z_x = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            z_x += get_element(y, i, 0) * get_element(x, i, 0);
+            if (fabs(get_element(y, i, 0)) > fabs(get_element(y, max_idx, 0))) {
+                max_idx = i;
+            }
+        }
+        if (fabs(get_element(y, max_idx, 0)) <= z_x || max_idx == last_idx) { // Локальный максимум достигнут
+            break;
+        }
+        for (size_t i = 0; i < n; i++) { // Переходим в вершину e_j с наибольшей компонентой градиента
+            set_element(x, i, 0, i == max_idx ? 1.0 : 0.0);
+        }
+        last_idx = max_idx;
+    }
+
+    // Дополнительная проверка на векторе с чередующимися знаками исправляет случаи, когда градиентный
+    // подъём останавливается в неудачной вершине
+    for (size_t i = 0; i < n; i++) {
+        set_element(x, i, 0, (i % 2 == 0 ? 1.0 : -1.0) * (1.0 + (n > 1 ? (data_t) i / (n - 1) : 0.0)));
+    }
+    transposed_solve(factor, x, y);
+    data_t alt_estimate = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        alt_estimate += fabs(get_element(y, i, 0));
+    }
+    alt_estimate = 2.0 * alt_estimate / (3.0 * n);
+    if (alt_estimate > estimate) {
+        estimate = alt_estimate;
+    }
+    if (!isfinite(estimate)) { // Нулевой главный элемент -- матрица вырождена
+        estimate = INFINITY;
+    }
+
+    free_matrix(x);
+    free_matrix(y);
+    free_matrix(tmp);
+    *status = OK;
+    return matrix_norm(a) * estimate;
 }
 
 data_t matrix_norm(Matrix *a)
@@ -179,42 +598,72 @@ data_t matrix_norm(Matrix *a)
 static size_t max_row_element(Matrix *a, const _Bool *cols_eliminated, size_t row);
 static size_t nonzero_row_element(Matrix *a, const _Bool *cols_eliminated, size_t row);
 
-static size_t *elimination(Matrix *a, Matrix *f, _Bool use_pivot)
+static size_t *elimination(Matrix *a, _Bool use_pivot, Workspace *workspace)
 {
-    size_t *col_order = calloc(a->col, sizeof(*col_order));// Чтобы исбежать дополнительных вычислений вместо
+    PROFILE_BEGIN("elimination");
+    size_t *col_order = workspace_alloc(workspace, a->col * sizeof(*col_order));// Чтобы исбежать дополнительных вычислений вместо
     // перестановки столбцов при выборе главного элемента или в случае 0 диагонального сохраняется
     // дополнительный массив с порядком перестановки столбцов
     if (col_order == NULL) {
         return NULL;
     }
-    _Bool *cols_eliminated = calloc(a->col, sizeof(*cols_eliminated)); // Также сохраняем информацию о том, какие
-    // столбцы были уже занулены каждом шаге
+    _Bool *cols_eliminated = workspace_alloc(workspace, a->col * sizeof(*cols_eliminated)); // Также сохраняем
+    // информацию о том, какие столбцы были уже занулены каждом шаге
     if (cols_eliminated == NULL) {
-        free(col_order);
+        workspace_free(workspace, col_order);
+        return NULL;
+    }
+    size_t *cols_left = workspace_alloc(workspace, a->col * sizeof(*cols_left)); // Номера ещё не занулённых
+    // столбцов. Занулённые столбцы хранят множители L и не должны изменяться при вычитании строк
+    if (cols_left == NULL) {
+        workspace_free(workspace, cols_eliminated);
+        workspace_free(workspace, col_order);
         return NULL;
     }
+    for (size_t i = 0; i < a->col; i++) {
+        cols_eliminated[i] = 0;
+        cols_left[i] = i;
+    }
+    size_t cols_left_count = a->col;
+
     for (size_t i = 0; i < a->row ; i++) {
         size_t pivot = use_pivot ? max_row_element(a, cols_eliminated, i) : // В зависимости от режима работы
                        nonzero_row_element(a, cols_eliminated, i); // выбирается либо максимальный элемент либо первый
                        // ненулевой в строке
         col_order[i] = pivot; // Записывем номер стобца в массив с порядком перестановки
         cols_eliminated[pivot] = 1; // Помечаем, что столбец был занулён
+        for (size_t k = 0; k < cols_left_count; k++) {
+            if (cols_left[k] == pivot) {
+                cols_left[k] = cols_left[--cols_left_count];
+                break;
+            }
+        }
         data_t pivot_value = get_element(a, i, pivot);
         if (eq_zero(pivot_value)) {
-            continue; // Если в качестве опорного эемента был выбран 0, то вся строка состоит из нулей и пропускается
+            // Если в качестве опорного эемента был выбран 0, то вся строка состоит из нулей и пропускается
+            for (size_t j = i + 1; j < a->row; j++) {
+                set_element(a, j, pivot, 0.0);
+            }
+            continue;
         }
 
+        // Строки обновляются независимо друг от друга, поэтому при достаточном объёме работы распределяются по потокам
+        PARALLEL_FOR(num_threads(get_thread_count()) if((a->row - i) * cols_left_count > PARALLEL_THRESHOLD) \
+                     schedule(static))
         for (size_t j = i + 1; j < a->row; j++) { // Из всех последующих строк вычитаем данную
             data_t coefficient = - get_element(a, j, pivot) / pivot_value; //  с необходимым коэффициентом
-            mul_sub_row(a, i, j, coefficient);
-            if (f != NULL) { // Функция может использоваться для вычисления определителя и тогда столбец свободных
-                mul_sub_row(f, i, j, coefficient); // членов будет отсутствовать
+            for (size_t k = 0; k < cols_left_count; k++) {
+                size_t col = cols_left[k];
+                set_element(a, j, col, get_element(a, j, col) + coefficient * get_element(a, i, col));
             }
+            set_element(a, j, pivot, coefficient); // На месте занулённого элемента сохраняем множитель
         }
+        PROFILE_COUNT((a->row - i - 1) * (2 * cols_left_count + 1), 0, 0);
 
     }
 
-    free(cols_eliminated);
+    workspace_free(workspace, cols_left);
+    workspace_free(workspace, cols_eliminated);
     return col_order;
 }
 
@@ -237,11 +686,16 @@ static size_t max_row_element(Matrix *a, const _Bool *cols_eliminated, size_t ro
 
 static size_t nonzero_row_element(Matrix *a, const _Bool *cols_eliminated, size_t row)
 {
+    size_t first_idx = a->col;
     for (size_t i = 0; i < a->col; i++) {
         if (!cols_eliminated[i] && !eq_zero(get_element(a, row, i))) {
             return i;
         }
+        if (!cols_eliminated[i] && first_idx == a->col) {
+            first_idx = i;
+        }
     }
 
-    return 0;
+    // Строка нулевая -- возвращаем первый незанулённый столбец, чтобы порядок столбцов оставался перестановкой
+    return first_idx;
 }
\ No newline at end of file
@@ -2,13 +2,55 @@
 #define LE_SOLVER_ALGS_H
 
 #include "matrix.h"
+#include "sparse.h"
+
+typedef struct {
+    Matrix *lu; // Множители L на месте занулённых элементов и матрица U с точностью до перестановки столбцов
+    size_t *col_order; // Порядок перестановки столбцов
+    Workspace *workspace; // Область памяти, в которой размещено разложение, или NULL для кучи
+} LUFactor;
+
+// Функции с суффиксом _ws размещают все промежуточные данные и результат в переданной области памяти, результат
+// действителен до её сброса. Размер области для решения системы с n неизвестными и rhs_cols правыми частями
+// возвращает gauss_workspace_size
+size_t gauss_workspace_size(size_t n, size_t rhs_cols);
+
+LUFactor *lu_factor(Matrix *a, _Bool use_pivot, int *status);
+
+LUFactor *lu_factor_ws(Matrix *a, _Bool use_pivot, Workspace *workspace, int *status);
+
+void free_lu_factor(LUFactor *factor);
+
+Matrix *lu_solve(LUFactor *factor, Matrix *f, int *status);
+
+Matrix *lu_solve_ws(LUFactor *factor, Matrix *f, Workspace *workspace, int *status);
+
+data_t lu_determinant(LUFactor *factor);
+
+Matrix *lu_inverse(LUFactor *factor, int *status);
+
+Matrix *lu_inverse_ws(LUFactor *factor, Workspace *workspace, int *status);
+
+// Оценка Хагера-Хайэма числа обусловленности по LU-разложению за O(n^2), без вычисления обратной матрицы
+data_t lu_condition_number(LUFactor *factor, Matrix *a, int *status);
 
 Matrix *gauss_solve(Matrix *a, Matrix *f, _Bool use_pivot, int *status);
 
+Matrix *gauss_solve_ws(Matrix *a, Matrix *f, _Bool use_pivot, Workspace *workspace, int *status);
+
+Matrix *sparse_gauss_solve(SparseMatrix *a, Matrix *f, int *status);
+
 data_t calc_determinant(Matrix *a, _Bool use_pivot, int *status);
 
+data_t calc_determinant_ws(Matrix *a, _Bool use_pivot, Workspace *workspace, int *status);
+
 Matrix *calc_inverse(Matrix *a, int *status);
 
-data_t calc_condition_number(Matrix *a, int *status);
+Matrix *calc_inverse_ws(Matrix *a, Workspace *workspace, int *status);
+
+data_t calc_condition_number(Matrix *a, _Bool exact, int *status);
+
+// Матричная норма ||A||_l -- наибольшая сумма модулей элементов строки
+data_t matrix_norm(Matrix *a);
 
 #endif //LE_SOLVER_ALGS_H
@@ -0,0 +1,99 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "band.h"
+
+BandMatrix *new_band_matrix(size_t n, size_t lower, size_t upper) {
+    BandMatrix *matrix = malloc(sizeof(*matrix));
+    if (matrix == NULL) {
+        return NULL;
+    }
+    matrix->n = n;
+    matrix->lower = lower;
+    matrix->upper = upper;
+    matrix->width = 2 * lower + upper + 1;
+    matrix->pivots = malloc((n != 0 ? n : 1) * sizeof(*matrix->pivots));
+    matrix->values = calloc(n * matrix->width + 1, sizeof(*matrix->values));
+    if (matrix->pivots == NULL || matrix->values == NULL) {
+        free_band_matrix(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+void free_band_matrix(BandMatrix *matrix) {
+    if (matrix == NULL) {
+        return;
+    }
+    free(matrix->pivots);
+    free(matrix->values);
+    free(matrix);
+}
+
+// Элемент (row, col) хранится со смещением col - row + lower от начала строки
+data_t get_band_element(BandMatrix *matrix, size_t row, size_t col) {
+    return matrix->values[row * matrix->width + col + matrix->lower - row];
+}
+
+void set_band_element(BandMatrix *matrix, size_t row, size_t col, data_t val) {
+    matrix->values[row * matrix->width + col + matrix->lower - row] = val;
+}
+
+void band_factor(BandMatrix *matrix) {
+    size_t n = matrix->n;
+    for (size_t k = 0; k < n; k++) {
+        // Главный элемент выбирается по модулю среди lower строк под диагональю
+        size_t last_row = k + matrix->lower < n - 1 ? k + matrix->lower : n - 1;
+        size_t last_col = k + matrix->upper + matrix->lower < n - 1 ? k + matrix->upper + matrix->lower : n - 1;
+        size_t pivot = k;
+        for (size_t i = k + 1; i <= last_row; i++) {
+            if (fabs(get_band_element(matrix, i, k)) > fabs(get_band_element(matrix, pivot, k))) {
+                pivot = i;
+            }
+        }
+        matrix->pivots[k] = pivot;
+        if (pivot != k) { // Меняем строки начиная со столбца k, множители предыдущих шагов остаются на местах
+            for (size_t j = k; j <= last_col; j++) {
+                data_t tmp = get_band_element(matrix, k, j);
+                set_band_element(matrix, k, j, get_band_element(matrix, pivot, j));
+                set_band_element(matrix, pivot, j, tmp);
+            }
+        }
+
+        data_t pivot_value = get_band_element(matrix, k, k);
+        if (!(fabs(pivot_value) > 0.0)) {
+            continue; // Столбец нулевой, исключать нечего
+        }
+        for (size_t i = k + 1; i <= last_row; i++) {
+            data_t coefficient = get_band_element(matrix, i, k) / pivot_value;
+            set_band_element(matrix, i, k, coefficient); // Множитель сохраняется на месте занулённого элемента
+            for (size_t j = k + 1; j <= last_col; j++) {
+                set_band_element(matrix, i, j,
+                                 get_band_element(matrix, i, j) - coefficient * get_band_element(matrix, k, j));
+            }
+        }
+    }
+}
+
+void band_solve(BandMatrix *matrix, Matrix *f) {
+    size_t n = matrix->n;
+    // Прямой ход повторяет перестановки и исключения разложения
+    for (size_t k = 0; k < n; k++) {
+        if (matrix->pivots[k] != k) {
+            swap_row(f, k, matrix->pivots[k]);
+        }
+        size_t last_row = k + matrix->lower < n - 1 ? k + matrix->lower : n - 1;
+        for (size_t i = k + 1; i <= last_row; i++) {
+            mul_sub_row(f, k, i, -get_band_element(matrix, i, k));
+        }
+    }
+    // Обратный ход по верхнетреугольной ленте ширины upper + lower
+    for (size_t k = n; k > 0; k--) {
+        size_t row = k - 1;
+        size_t last_col = row + matrix->upper + matrix->lower < n - 1 ? row + matrix->upper + matrix->lower : n - 1;
+        for (size_t j = row + 1; j <= last_col; j++) {
+            mul_sub_row(f, j, row, -get_band_element(matrix, row, j));
+        }
+        mul_row(f, row, 1.0 / get_band_element(matrix, row, row));
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef LE_SOLVER_BAND_H
+#define LE_SOLVER_BAND_H
+
+#include "matrix.h"
+
+// Ленточная матрица с lower поддиагоналями и upper наддиагоналями. В каждой строке i хранятся элементы столбцов
+// i - lower .. i + upper + lower, дополнительные lower элементов -- место для заполнения при выборе главного элемента
+typedef struct {
+    size_t n;
+    size_t lower;
+    size_t upper;
+    size_t width;
+    size_t *pivots; // Номер строки, переставленной с i-ой на i-ом шаге разложения
+    data_t *values;
+} BandMatrix;
+
+BandMatrix *new_band_matrix(size_t n, size_t lower, size_t upper);
+
+void free_band_matrix(BandMatrix *matrix);
+
+data_t get_band_element(BandMatrix *matrix, size_t row, size_t col);
+
+void set_band_element(BandMatrix *matrix, size_t row, size_t col, data_t val);
+
+void band_factor(BandMatrix *matrix);
+
+void band_solve(BandMatrix *matrix, Matrix *f);
+
+#endif //LE_SOLVER_BAND_H
@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "algs.h"
+#include "relaxation.h"
+#include "small.h"
+#include "error.h"
+#include "threads.h"
+#include "io.h"
+
+typedef struct {
+    Matrix *a;
+    Matrix *f;
+    Matrix *x;
+    int status;
+} BatchSystem;
+
+// Матрицы ячейки пересоздаются только при изменении размера системы, поэтому поток систем одного размера
+// обрабатывается без обращений к куче
+static int ensure_system(BatchSystem *system, size_t n)
+{
+    if (system->a != NULL && system->a->row == n) {
+        return OK;
+    }
+    free_matrix(system->a);
+    free_matrix(system->f);
+    free_matrix(system->x);
+    system->a = new_matrix(n, n);
+    system->f = new_matrix(n, 1);
+    system->x = new_matrix(n, 1);
+    if (system->a == NULL || system->f == NULL || system->x == NULL) {
+        free_matrix(system->a);
+        free_matrix(system->f);
+        free_matrix(system->x);
+        system->a = system->f = system->x = NULL;
+        return ALLOC_FAILED;
+    }
+    return OK;
+}
+
+// Считывает систему: размер n, затем n * n элементов матрицы A и n элементов столбца f
+static int read_system(TextReader *in, BatchSystem *system, int *status)
+{
+    size_t n;
+    if (!read_size(in, &n)) {
+        return 0;
+    }
+    if ((*status = ensure_system(system, n)) != OK) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            data_t in_value;
+            if (!read_value(in, &in_value)) {
+                *status = INCORRECT_ARGS;
+                return 0;
+            }
+            set_element(system->a, i, j, in_value);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        data_t in_value;
+        if (!read_value(in, &in_value)) {
+            *status = INCORRECT_ARGS;
+            return 0;
+        }
+        set_element(system->f, i, 0, in_value);
+    }
+    return 1;
+}
+
+static void solve_system(BatchSystem *system, int method, data_t omega, Workspace *workspace)
+{
+    Matrix *x;
+    if (method == BATCH_GAUSS) {
+        reset_workspace(workspace);
+        x = gauss_solve_ws(system->a, system->f, 1, workspace, &system->status);
+    } else {
+        size_t iters;
+        x = relaxation(system->a, system->f, omega, 1e-10, &iters, &system->status);
+    }
+    if (x != NULL) {
+        memcpy(system->x->values, x->values, x->row * sizeof(*x->values));
+        free_matrix(x);
+    }
+}
+
+static _Bool is_small(BatchSystem *system, int method)
+{
+    return method == BATCH_GAUSS && system->a->row >= SMALL_MIN_N && system->a->row <= SMALL_MAX_N;
+}
+
+// Решение до small_lanes() систем одного малого размера векторным ядром. Матрицы и столбцы переписываются в формат
+// структуры массивов, недостающие системы пакета заменяются системами с единичной матрицей
+static void solve_small(BatchSystem *systems, const size_t *index, size_t count, size_t lanes)
+{
+    size_t n = systems[index[0]].a->row;
+    data_t a[SMALL_MAX_N * SMALL_MAX_N * SMALL_MAX_LANES], f[SMALL_MAX_N * SMALL_MAX_LANES];
+    for (size_t l = 0; l < lanes; l++) {
+        BatchSystem *system = l < count ? &systems[index[l]] : NULL;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) {
+                a[(i * n + j) * lanes + l] = system != NULL ? system->a->values[i * system->a->stride + j] : (i == j);
+            }
+            f[i * lanes + l] = system != NULL ? system->f->values[i * system->f->stride] : 0.0;
+        }
+    }
+
+    int status;
+    small_solve(n, a, f, &status);
+    for (size_t l = 0; l < count; l++) {
+        BatchSystem *system = &systems[index[l]];
+        for (size_t i = 0; i < n; i++) {
+            system->x->values[i * system->x->stride] = f[i * lanes + l];
+        }
+        system->status = status;
+    }
+}
+
+int batch_solve(FILE *in, FILE *out, int method, int format, data_t omega, size_t *solved) {
+    if (method != BATCH_GAUSS && method != BATCH_RELAXATION) {
+        return INCORRECT_ARGS;
+    }
+    size_t threads = get_thread_count(), lanes = small_lanes();
+    BatchSystem *systems = calloc(BATCH_CHUNK, sizeof(*systems));
+    Workspace **workspaces = calloc(threads, sizeof(*workspaces)); // Отдельная область памяти для каждого потока
+    TextReader *reader = new_text_reader(in);
+    size_t workspace_n = 0;
+    if (systems == NULL || workspaces == NULL || reader == NULL) {
+        free(systems);
+        free(workspaces);
+        free_text_reader(reader);
+        return ALLOC_FAILED;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = OK;
+    *solved = 0;
+    for (;;) {
+        // Системы считываются последовательно порциями, решаются параллельно и выводятся в порядке ввода
+        size_t count = 0, max_n = 0;
+        while (count < BATCH_CHUNK && read_system(reader, &systems[count], &status)) {
+            if (systems[count].a->row > max_n) {
+                max_n = systems[count].a->row;
+            }
+            count++;
+        }
+        if (count == 0) {
+            break;
+        }
+        if (max_n > workspace_n) {
+            for (size_t t = 0; t < threads; t++) {
+                free_workspace(workspaces[t]);
+                if ((workspaces[t] = new_workspace(gauss_workspace_size(max_n, 1))) == NULL) {
+                    status = ALLOC_FAILED;
+                }
+            }
+            if (status != OK) {
+                break;
+            }
+            workspace_n = max_n;
+        }
+
+        // Малые системы упорядочиваются по размеру и делятся на пакеты по lanes систем: group[g] -- начало
+        // пакета g в small
+        size_t small[BATCH_CHUNK], group[BATCH_CHUNK + 1];
+        size_t small_count = 0, group_count = 0;
+        for (size_t n = SMALL_MIN_N; method == BATCH_GAUSS && n <= SMALL_MAX_N; n++) {
+            size_t first = small_count;
+            for (size_t k = 0; k < count; k++) {
+                if (systems[k].a->row == n) {
+                    small[small_count++] = k;
+                }
+            }
+            for (size_t g = first; g < small_count; g += lanes) {
+                group[group_count++] = g;
+            }
+        }
+        group[group_count] = small_count;
+
+        PARALLEL_FOR(num_threads(threads) schedule(dynamic))
+        for (size_t g = 0; g < group_count; g++) {
+            solve_small(systems, small + group[g], group[g + 1] - group[g], lanes);
+        }
+        PARALLEL_FOR(num_threads(threads) schedule(dynamic))
+        for (size_t k = 0; k < count; k++) {
+            if (!is_small(&systems[k], method)) {
+                solve_system(&systems[k], method, omega, workspaces[get_thread_index()]);
+            }
+        }
+
+        for (size_t k = 0; k < count; k++) {
+            if (format == FORMAT_BINARY) {
+                // Вместо решения, которое не удалось найти, записывается пустая матрица, чтобы номера записей
+                // совпадали с номерами систем
+                Matrix empty = {0, 0, 0, STORAGE_HEAP, NULL};
+                print_matrix(out, systems[k].status == OK ? systems[k].x : &empty, format);
+                continue;
+            }
+            if (systems[k].status == OK) {
+                print_matrix(out, systems[k].x, format);
+            } else {
+                fputs("Ошибка во время решения системы\n", out);
+            }
+            fputs("\n", out);
+        }
+        *solved += count;
+        if (status != OK || count < BATCH_CHUNK) {
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    data_t elapsed = (data_t) (end.tv_sec - start.tv_sec) + (data_t) (end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "Решено систем : %lu за %.3" PR_DATA_T " с (%.1" PR_DATA_T " систем/с)\n", (unsigned long) *solved,
+            elapsed, elapsed > 0.0 ? (data_t) *solved / elapsed : 0.0);
+
+    for (size_t k = 0; k < BATCH_CHUNK; k++) {
+        free_matrix(systems[k].a);
+        free_matrix(systems[k].f);
+        free_matrix(systems[k].x);
+    }
+    for (size_t t = 0; t < threads; t++) {
+        free_workspace(workspaces[t]);
+    }
+    free(systems);
+    free(workspaces);
+    free_text_reader(reader);
+    return status;
+}
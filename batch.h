@@ -0,0 +1,18 @@
+#ifndef LE_SOLVER_BATCH_H
+#define LE_SOLVER_BATCH_H
+
+#include <stdio.h>
+
+#include "matrix.h"
+
+// Число систем, которые считываются и решаются параллельно за один шаг пакетного режима
+#define BATCH_CHUNK 256
+
+enum {
+    BATCH_GAUSS = 1,
+    BATCH_RELAXATION
+};
+
+int batch_solve(FILE *in, FILE *out, int method, int format, data_t omega, size_t *solved);
+
+#endif //LE_SOLVER_BATCH_H
@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "matrix.h"
+#include "algs.h"
+#include "relaxation.h"
+#include "mixed.h"
+#include "krylov.h"
+#include "sparse.h"
+#include "generate.h"
+#include "cholesky.h"
+#include "structure.h"
+#include "io.h"
+#include "error.h"
+#include "profile.h"
+
+/*
+ * Замер производительности всех методов решения на сгенерированных системах
+ *
+ * Аргументы (все необязательные):
+ * --sizes <n1,n2,...>  размеры систем, по умолчанию 32,64,128,256
+ * --kinds <k1,k2,...>  виды систем: function, random, spd, banded; по умолчанию все
+ * --repeats <r>        число повторов каждого замера, по умолчанию 5
+ * --param <m>          параметр m функции генерации и полуширина ленты, по умолчанию 4
+ * --omega <w>          параметр омега методов верхней релаксации, по умолчанию 1.2. При w <= 0 омега
+ *                      подбирается автоматически
+ * --format <csv|json>  формат отчёта, по умолчанию csv
+ *
+ * Для каждого вида, размера и метода выводится медиана и минимум времени, производительность в GFLOP/s по
+ * медиане и число итераций итерационных методов. Число операций оценивается по главным членам сложности
+ * алгоритма, поэтому GFLOP/s служит для сравнения версий между собой, а не с пиковой производительностью
+ */
+
+typedef struct {
+    Matrix *a;
+    Matrix *f;
+    SparseMatrix *sparse;
+    data_t omega;
+    _Bool positive; // Плотная симметричная положительно определённая матрица, gauss_solve раскладывает её по Холецкому
+} BenchSystem;
+
+typedef struct {
+    const char *name;
+    int (*run)(BenchSystem *system, size_t *iters);
+    data_t (*flops)(BenchSystem *system, size_t iters); // NULL, если оценки числа операций нет
+} BenchRoutine;
+
+static int finish(Matrix *result, int status)
+{
+    free_matrix(result);
+    return result != NULL ? status : (status != OK ? status : ALLOC_FAILED);
+}
+
+static int run_gauss(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    Matrix *solution = gauss_solve(system->a, system->f, 0, &status);
+    return finish(solution, status);
+}
+
+static int run_gauss_pivot(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    Matrix *solution = gauss_solve(system->a, system->f, 1, &status);
+    return finish(solution, status);
+}
+
+static int run_gauss_mixed(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Matrix *solution = gauss_solve_mixed(system->a, system->f, iters, &status);
+    return finish(solution, status);
+}
+
+static int run_determinant(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    calc_determinant(system->a, 1, &status);
+    return status;
+}
+
+static int run_inverse(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    Matrix *solution = calc_inverse(system->a, &status);
+    return finish(solution, status);
+}
+
+static int run_condition_number(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    calc_condition_number(system->a, 0, &status);
+    return status;
+}
+
+static int run_matrix_mul(BenchSystem *system, size_t *iters)
+{
+    *iters = 0;
+    return finish(matrix_mul(system->a, system->a), OK);
+}
+
+static int run_relaxation(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Matrix *solution = relaxation(system->a, system->f, system->omega, 1e-10, iters, &status);
+    return finish(solution, status);
+}
+
+static int run_relaxation_multicolor(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Matrix *solution = relaxation_multicolor(system->a, system->f, system->omega, 1e-10, iters, &status);
+    return finish(solution, status);
+}
+
+static int run_relaxation_normal(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Matrix *solution = relaxation_normal(system->a, system->f, system->omega, 1e-10, iters, &status);
+    return finish(solution, status);
+}
+
+static int run_relaxation_chebyshev(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Matrix *solution = relaxation_chebyshev(system->a, system->f, system->omega, 1e-10, iters, &status);
+    return finish(solution, status);
+}
+
+static int run_sparse_gauss(BenchSystem *system, size_t *iters)
+{
+    int status;
+    *iters = 0;
+    Matrix *solution = sparse_gauss_solve(system->sparse, system->f, &status);
+    return finish(solution, status);
+}
+
+static int run_gmres(BenchSystem *system, size_t *iters)
+{
+    int status;
+    Preconditioner *preconditioner = ilu0_preconditioner(system->sparse, &status);
+    Matrix *solution = gmres_solve(sparse_matvec, system->sparse, system->f, preconditioner, 30, 1e-10,
+                                   10 * system->a->row + 100, iters, &status);
+    free_preconditioner(preconditioner);
+    return finish(solution, status);
+}
+
+static data_t flops_lu(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    (void) iters;
+    return 2.0 * n * n * n / 3.0;
+}
+
+static data_t flops_lu_solve(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    return flops_lu(system, iters) + 2.0 * n * n;
+}
+
+// gauss_solve без выбора главного элемента для положительно определённых матриц выполняет разложение Холецкого
+static data_t flops_gauss_solve(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    return system->positive ? n * n * n / 3.0 + 2.0 * n * n : flops_lu_solve(system, iters);
+}
+
+static data_t flops_cube(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    (void) iters;
+    return 2.0 * n * n * n;
+}
+
+// Построение A^T * A и A^T * f, затем по одному умножению строки на вектор на каждое неизвестное за итерацию
+static data_t flops_relaxation(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    return 2.0 * n * n * n + 2.0 * n * n + 2.0 * n * n * (data_t) iters;
+}
+
+// Как flops_relaxation, но каждая итерация состоит из прямого и обратного прохода
+static data_t flops_relaxation_chebyshev(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    return 2.0 * n * n * n + 2.0 * n * n + 4.0 * n * n * (data_t) iters;
+}
+
+// Скалярное произведение со столбцом A и обновление невязки на каждое неизвестное за итерацию
+static data_t flops_relaxation_normal(BenchSystem *system, size_t iters)
+{
+    data_t n = (data_t) system->a->row;
+    return 4.0 * n * n * (data_t) iters;
+}
+
+// Умножение на матрицу и применение ILU(0) на каждой итерации
+static data_t flops_gmres(BenchSystem *system, size_t iters)
+{
+    return 4.0 * (data_t) system->sparse->nnz * (data_t) iters;
+}
+
+static const BenchRoutine routines[] = {
+        {"gauss_solve",           run_gauss,                 flops_gauss_solve},
+        {"gauss_solve_pivot",     run_gauss_pivot,           flops_lu_solve},
+        {"gauss_solve_mixed",     run_gauss_mixed,           flops_lu_solve},
+        {"calc_determinant",      run_determinant,           flops_lu},
+        {"calc_inverse",          run_inverse,               flops_cube},
+        {"calc_condition_number", run_condition_number,      flops_lu},
+        {"matrix_mul",            run_matrix_mul,            flops_cube},
+        {"relaxation",            run_relaxation,            flops_relaxation},
+        {"relaxation_multicolor", run_relaxation_multicolor, flops_relaxation},
+        {"relaxation_normal",     run_relaxation_normal,     flops_relaxation_normal},
+        {"relaxation_chebyshev",  run_relaxation_chebyshev,  flops_relaxation_chebyshev},
+        {"sparse_gauss_solve",    run_sparse_gauss,          NULL},
+        {"gmres_ilu0",            run_gmres,                 flops_gmres},
+};
+
+static const char *kind_names[] = {"function", "random", "spd", "banded"};
+
+#define KIND_COUNT (sizeof(kind_names) / sizeof(*kind_names))
+#define ROUTINE_COUNT (sizeof(routines) / sizeof(*routines))
+
+static data_t elapsed_since(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (data_t) (end.tv_sec - start->tv_sec) + (data_t) (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static int compare_data(const void *a, const void *b)
+{
+    data_t x = *(const data_t *) a, y = *(const data_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Разбирает список вида "32,64,128" в массив, возвращает число элементов
+static size_t parse_sizes(const char *list, size_t *sizes, size_t capacity)
+{
+    size_t count = 0;
+    const char *p = list;
+    while (*p != '\0' && count < capacity) {
+        char *end;
+        sizes[count] = strtoul(p, &end, 0);
+        if (end == p) {
+            break;
+        }
+        count += sizes[count] != 0;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static void print_number(FILE *out, data_t value)
+{
+    char buffer[SHORTEST_BUFFER_SIZE];
+    format_shortest(value, buffer);
+    fputs(buffer, out);
+}
+
+int main(int argc, char *argv[]) {
+    size_t sizes[64] = {32, 64, 128, 256};
+    size_t size_count = 4;
+    _Bool kinds[KIND_COUNT] = {1, 1, 1, 1};
+    size_t repeats = 5, param = 4;
+    data_t omega = 1.2;
+    _Bool json = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--sizes") == 0) {
+            size_count = parse_sizes(argv[i + 1], sizes, sizeof(sizes) / sizeof(*sizes));
+        } else if (strcmp(argv[i], "--kinds") == 0) {
+            for (size_t k = 0; k < KIND_COUNT; k++) {
+                kinds[k] = strstr(argv[i + 1], kind_names[k]) != NULL;
+            }
+        } else if (strcmp(argv[i], "--repeats") == 0) {
+            repeats = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--param") == 0) {
+            param = strtoul(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--omega") == 0) {
+            omega = strtod(argv[i + 1], NULL);
+        } else if (strcmp(argv[i], "--format") == 0) {
+            json = strcmp(argv[i + 1], "json") == 0;
+        } else {
+            fprintf(stderr, "Неизвестный аргумент %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (size_count == 0 || repeats == 0 || param == 0) {
+        fprintf(stderr, "Некорректные параметры замера\n");
+        return 1;
+    }
+
+    data_t *times = malloc(repeats * sizeof(*times));
+    if (times == NULL) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        return 1;
+    }
+    if (json) {
+        printf("[");
+    } else {
+        printf("kind,n,routine,repeats,median_s,min_s,gflops,iterations,status\n");
+    }
+
+    _Bool first = 1;
+    for (size_t k = 0; k < KIND_COUNT; k++) {
+        if (!kinds[k]) {
+            continue;
+        }
+        for (size_t s = 0; s < size_count; s++) {
+            size_t n = sizes[s];
+            int status;
+            BenchSystem system = {new_matrix(n, n), new_matrix(n, 1), NULL, omega, 0};
+            if (system.a == NULL || system.f == NULL ||
+                generate_system((int) k, param, 42 + n, system.a, system.f) != OK ||
+                (system.sparse = sparse_from_dense(system.a, &status)) == NULL) {
+                fprintf(stderr, "Ошибка выделения памяти\n");
+                free_matrix(system.a);
+                free_matrix(system.f);
+                free(times);
+                return 1;
+            }
+            if (detect_structure(system.a).type == STRUCTURE_DENSE && is_symmetric(system.a)) {
+                CholeskyFactor *cholesky = cholesky_factor_positive(system.a, &status);
+                system.positive = cholesky != NULL;
+                free_cholesky_factor(cholesky);
+            }
+
+            for (size_t r = 0; r < ROUTINE_COUNT; r++) {
+                size_t iters = 0, done = 0;
+                status = OK;
+                while (done < repeats && status == OK) { // После ошибки замер не повторяется
+                    struct timespec start;
+                    clock_gettime(CLOCK_MONOTONIC, &start);
+                    status = routines[r].run(&system, &iters);
+                    times[done++] = elapsed_since(&start);
+                }
+                qsort(times, done, sizeof(*times), compare_data);
+                data_t median = done % 2 != 0 ? times[done / 2] : (times[done / 2 - 1] + times[done / 2]) / 2.0;
+                _Bool has_flops = status == OK && routines[r].flops != NULL && median > 0.0;
+                data_t gflops = has_flops ? routines[r].flops(&system, iters) / median * 1e-9 : 0.0;
+                const char *status_name = status == OK ? "ok" : status == NOT_CONVERGED ? "not_converged" : "error";
+
+                if (json) {
+                    printf("%s\n  {\"kind\": \"%s\", \"n\": %lu, \"routine\": \"%s\", \"repeats\": %lu, \"median_s\": ",
+                           first ? "" : ",", kind_names[k], (unsigned long) n, routines[r].name,
+                           (unsigned long) done);
+                    print_number(stdout, median);
+                    printf(", \"min_s\": ");
+                    print_number(stdout, times[0]);
+                    printf(", \"gflops\": ");
+                    if (has_flops) {
+                        print_number(stdout, gflops);
+                    } else {
+                        printf("null");
+                    }
+                    printf(", \"iterations\": %lu, \"status\": \"%s\"}", (unsigned long) iters, status_name);
+                } else {
+                    printf("%s,%lu,%s,%lu,", kind_names[k], (unsigned long) n, routines[r].name,
+                           (unsigned long) done);
+                    print_number(stdout, median);
+                    printf(",");
+                    print_number(stdout, times[0]);
+                    printf(",");
+                    if (has_flops) {
+                        print_number(stdout, gflops);
+                    }
+                    printf(",%lu,%s\n", (unsigned long) iters, status_name);
+                }
+                fflush(stdout);
+                first = 0;
+            }
+
+            free_sparse_matrix(system.sparse);
+            free_matrix(system.a);
+            free_matrix(system.f);
+        }
+    }
+    if (json) {
+        printf("\n]\n");
+    }
+    free(times);
+    PROFILE_FINISH();
+    return 0;
+}
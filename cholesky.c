@@ -0,0 +1,193 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "cholesky.h"
+#include "error.h"
+#include "profile.h"
+
+// Строки упакованного треугольника обрабатываются блоками по CHOLESKY_BLOCK: пока вычисляются элементы блока
+// строк I в столбцах блока J, строки блока J остаются в кэше
+#define CHOLESKY_BLOCK 32
+// Элемент D меньше этой доли наибольшего по модулю диагонального элемента A считается нулевым
+#define LDL_PIVOT_RATIO 1e-12
+
+#define PACKED_ROW(packed, i) ((packed) + (i) * ((i) + 1) / 2)
+
+_Bool is_symmetric(Matrix *a) {
+    if (a == NULL || a->row != a->col) {
+        return 0;
+    }
+    // Сравнение точное: разложение использует только нижний треугольник, и верхний не должен отличаться от него
+    for (size_t i = 0; i < a->row; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (fabs(get_element(a, i, j) - get_element(a, j, i)) > 0.0) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void free_cholesky_factor(CholeskyFactor *factor) {
+    if (factor == NULL) {
+        return;
+    }
+    free(factor->packed);
+    free(factor->diagonal);
+    free(factor);
+}
+
+// Скалярное произведение начал строк L длины count, для LDL^T -- с весами D
+static data_t row_dot(CholeskyFactor *factor, const data_t *x, const data_t *y, size_t count)
+{
+    data_t sum = 0.0;
+    if (factor->positive) {
+        for (size_t k = 0; k < count; k++) {
+            sum += x[k] * y[k];
+        }
+    } else {
+        for (size_t k = 0; k < count; k++) {
+            sum += x[k] * factor->diagonal[k] * y[k];
+        }
+    }
+    return sum;
+}
+
+// Построчный (Краута) вариант разложения: l_ij = (a_ij - sum_(k<j) l_ik * d_k * l_jk) / (d_j * l_jj). Элементы
+// строки i зависят только от предыдущих строк, поэтому блоки строк обрабатываются по порядку
+static int factor_rows(CholeskyFactor *factor, Matrix *a)
+{
+    size_t n = factor->n;
+    data_t scale = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        scale = fmax(scale, fabs(get_element(a, i, i)));
+    }
+
+    for (size_t block_i = 0; block_i < n; block_i += CHOLESKY_BLOCK) {
+        size_t end_i = block_i + CHOLESKY_BLOCK < n ? block_i + CHOLESKY_BLOCK : n;
+        for (size_t block_j = 0; block_j <= block_i; block_j += CHOLESKY_BLOCK) {
+            for (size_t i = block_i; i < end_i; i++) {
+                data_t *row = PACKED_ROW(factor->packed, i);
+                size_t end_j = block_j + CHOLESKY_BLOCK < i ? block_j + CHOLESKY_BLOCK : i;
+                for (size_t j = block_j; j < end_j; j++) {
+                    data_t *pivot_row = PACKED_ROW(factor->packed, j);
+                    data_t value = get_element(a, i, j) - row_dot(factor, row, pivot_row, j);
+                    row[j] = factor->positive ? value / pivot_row[j] : value / factor->diagonal[j];
+                }
+                if (i >= block_j + CHOLESKY_BLOCK) {
+                    continue; // Диагональный элемент строки вычисляется в блоке, содержащем столбец i
+                }
+
+                data_t value = get_element(a, i, i) - row_dot(factor, row, row, i);
+                if (factor->positive) {
+                    if (!(value > 0.0)) { // Матрица не положительно определена
+                        return INCORRECT_ARGS;
+                    }
+                    row[i] = sqrt(value);
+                } else {
+                    if (!(fabs(value) > LDL_PIVOT_RATIO * scale)) {
+                        return INCORRECT_ARGS;
+                    }
+                    factor->diagonal[i] = value;
+                    row[i] = 1.0;
+                }
+            }
+        }
+    }
+    return OK;
+}
+
+// Если indefinite ложно, разложение LDL^T не выполняется и для не положительно определённой матрицы возвращается NULL
+static CholeskyFactor *factor_symmetric(Matrix *a, _Bool indefinite, int *status)
+{
+    PROFILE_BEGIN("cholesky_factor");
+    if (a == NULL || !is_symmetric(a)) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = a->row;
+    CholeskyFactor *factor = malloc(sizeof(*factor));
+    if (factor == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    factor->n = n;
+    factor->positive = 1;
+    factor->diagonal = NULL;
+    factor->packed = malloc((n * (n + 1) / 2 + 1) * sizeof(*factor->packed));
+    if (factor->packed == NULL) {
+        *status = ALLOC_FAILED;
+        free_cholesky_factor(factor);
+        return NULL;
+    }
+    PROFILE_COUNT(n * n * n / 3, n * (n + 1) / 2 * sizeof(data_t), 0);
+
+    if ((*status = factor_rows(factor, a)) == OK) {
+        return factor;
+    }
+    if (!indefinite) {
+        free_cholesky_factor(factor);
+        return NULL;
+    }
+    factor->positive = 0; // Повторяем разложение в виде LDL^T
+    factor->diagonal = malloc((n != 0 ? n : 1) * sizeof(*factor->diagonal));
+    if (factor->diagonal == NULL) {
+        *status = ALLOC_FAILED;
+        free_cholesky_factor(factor);
+        return NULL;
+    }
+    if ((*status = factor_rows(factor, a)) != OK) {
+        free_cholesky_factor(factor);
+        return NULL;
+    }
+    return factor;
+}
+
+CholeskyFactor *cholesky_factor(Matrix *a, int *status) {
+    return factor_symmetric(a, 1, status);
+}
+
+CholeskyFactor *cholesky_factor_positive(Matrix *a, int *status) {
+    return factor_symmetric(a, 0, status);
+}
+
+Matrix *cholesky_solve(CholeskyFactor *factor, Matrix *f, int *status) {
+    PROFILE_BEGIN("cholesky_solve");
+    if (factor == NULL || f == NULL || f->row != factor->n) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Matrix *answ = copy_matrix(f);
+    if (answ == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    size_t n = factor->n;
+    PROFILE_COUNT(2 * n * n * f->col, 0, 0);
+
+    // L * y = f по строкам L, затем D * z = y и L^T * x = z по тем же строкам, т.е. по столбцам L^T
+    for (size_t i = 0; i < n; i++) {
+        data_t *row = PACKED_ROW(factor->packed, i);
+        for (size_t j = 0; j < i; j++) {
+            mul_sub_row(answ, j, i, -row[j]);
+        }
+        if (factor->positive) {
+            mul_row(answ, i, 1.0 / row[i]);
+        }
+    }
+    for (size_t i = 0; i < n && !factor->positive; i++) {
+        mul_row(answ, i, 1.0 / factor->diagonal[i]);
+    }
+    for (size_t i = n; i > 0; i--) {
+        data_t *row = PACKED_ROW(factor->packed, i - 1);
+        if (factor->positive) {
+            mul_row(answ, i - 1, 1.0 / row[i - 1]);
+        }
+        for (size_t j = 0; j < i - 1; j++) {
+            mul_sub_row(answ, i - 1, j, -row[j]);
+        }
+    }
+
+    *status = OK;
+    return answ;
+}
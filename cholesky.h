@@ -0,0 +1,31 @@
+#ifndef LE_SOLVER_CHOLESKY_H
+#define LE_SOLVER_CHOLESKY_H
+
+#include "matrix.h"
+
+// Разложение симметричной матрицы A = L * L^T (метод Холецкого) для положительно определённых матриц или
+// A = L * D * L^T с единичной диагональю L для знаконеопределённых. Хранится только нижний треугольник L,
+// упакованный по строкам: элемент (i, j), j <= i, находится в packed[i * (i + 1) / 2 + j]
+typedef struct {
+    size_t n;
+    _Bool positive; // Разложение Холецкого, иначе LDL^T
+    data_t *packed;
+    data_t *diagonal; // Диагональ D для LDL^T, NULL для разложения Холецкого
+} CholeskyFactor;
+
+_Bool is_symmetric(Matrix *a);
+
+// Сначала выполняется разложение Холецкого, а если матрица оказывается не положительно определённой -- LDL^T.
+// Разложение LDL^T выполняется без выбора главного элемента, поэтому при слишком малом элементе D оно прерывается
+// со статусом INCORRECT_ARGS, как и для несимметричной матрицы
+CholeskyFactor *cholesky_factor(Matrix *a, int *status);
+
+// Только разложение Холецкого: для матрицы, не являющейся положительно определённой, возвращается NULL со статусом
+// INCORRECT_ARGS. В отличие от LDL^T без выбора главного элемента, оно устойчиво для любой такой матрицы
+CholeskyFactor *cholesky_factor_positive(Matrix *a, int *status);
+
+void free_cholesky_factor(CholeskyFactor *factor);
+
+Matrix *cholesky_solve(CholeskyFactor *factor, Matrix *f, int *status);
+
+#endif //LE_SOLVER_CHOLESKY_H
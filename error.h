@@ -4,7 +4,8 @@
 enum {
     OK = 0,
     ALLOC_FAILED,
-    INCORRECT_ARGS
+    INCORRECT_ARGS,
+    NOT_CONVERGED
 };
 
 #endif //LE_SOLVER_ERROR_H
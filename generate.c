@@ -0,0 +1,67 @@
+#include <math.h>
+
+#include "generate.h"
+#include "error.h"
+
+data_t gen_function_a(size_t n, size_t m, size_t i, size_t j) {
+    return i == j ? n + ((data_t) m) * m + ((data_t) j) / m + ((data_t) i) / n
+            : ((data_t) i + j) / (((data_t)m) + n);
+}
+
+data_t gen_function_f(size_t n, size_t m, size_t i) {
+    return ((data_t) m) * i + n;
+}
+
+// Генератор xorshift64*: последовательность определяется только зерном, поэтому системы воспроизводимы
+static data_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    uint64_t bits = *state * UINT64_C(2685821657736338717);
+    return (data_t) (bits >> 11) / (data_t) (UINT64_C(1) << 53) * 2.0 - 1.0; // Равномерно в [-1, 1)
+}
+
+int generate_system(int kind, size_t m, uint64_t seed, Matrix *a, Matrix *f) {
+    if (a == NULL || f == NULL || a->row != a->col || f->row != a->row || f->col != 1) {
+        return INCORRECT_ARGS;
+    }
+    size_t n = a->row;
+    uint64_t state = seed != 0 ? seed : 1;
+
+    if (kind == GEN_FUNCTION) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) {
+                set_element(a, i, j, gen_function_a(n, m, i, j));
+            }
+            set_element(f, i, 0, gen_function_f(n, m, i));
+        }
+        return OK;
+    }
+    if (kind != GEN_RANDOM && kind != GEN_SPD && kind != GEN_BANDED) {
+        return INCORRECT_ARGS;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            data_t value = 0.0;
+            if (kind == GEN_SPD) { // Симметричная часть заполняется по верхнему треугольнику
+                value = j < i ? get_element(a, j, i) : next_random(&state);
+            } else if (kind == GEN_RANDOM || (i <= j + m && j <= i + m)) {
+                value = next_random(&state);
+            }
+            set_element(a, i, j, value);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        // Диагональ больше суммы модулей остальных элементов строки, поэтому матрица невырождена, а для
+        // симметричной матрицы ещё и положительно определена
+        data_t off_diagonal = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            off_diagonal += j != i ? fabs(get_element(a, i, j)) : 0.0;
+        }
+        set_element(a, i, i, kind == GEN_RANDOM ? get_element(a, i, i) + sqrt((data_t) n) : off_diagonal + 1.0);
+        set_element(f, i, 0, next_random(&state));
+    }
+    return OK;
+}
@@ -0,0 +1,22 @@
+#ifndef LE_SOLVER_GENERATE_H
+#define LE_SOLVER_GENERATE_H
+
+#include <stdint.h>
+
+#include "matrix.h"
+
+// Виды генерируемых систем
+enum {
+    GEN_FUNCTION = 0, // Функции gen_function_a и gen_function_f с параметром m
+    GEN_RANDOM,       // Несимметричная матрица со случайными элементами из [-1, 1] и усиленной диагональю
+    GEN_SPD,          // Симметричная положительно определённая матрица со строгим диагональным преобладанием
+    GEN_BANDED        // Ленточная матрица с полушириной ленты m и диагональным преобладанием
+};
+
+data_t gen_function_a(size_t n, size_t m, size_t i, size_t j);
+
+data_t gen_function_f(size_t n, size_t m, size_t i);
+
+int generate_system(int kind, size_t m, uint64_t seed, Matrix *a, Matrix *f);
+
+#endif //LE_SOLVER_GENERATE_H
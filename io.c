@@ -0,0 +1,666 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "error.h"
+
+_Static_assert(sizeof(MatrixFileHeader) == MATRIX_ALIGNMENT, "header must keep records aligned");
+
+static size_t record_size(size_t row, size_t col)
+{
+    return sizeof(MatrixFileHeader) + MATRIX_ALIGN_UP(row * col * sizeof(data_t));
+}
+
+MatrixFile *open_matrix_file(const char *path, int *status) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        *status = INCORRECT_ARGS;
+        close(fd);
+        return NULL;
+    }
+    MatrixFile *file = calloc(1, sizeof(*file));
+    if (file == NULL) {
+        *status = ALLOC_FAILED;
+        close(fd);
+        return NULL;
+    }
+    file->size = (size_t) st.st_size;
+    // Закрытое отображение: алгоритмы могут изменять значения, но изменения не попадают в файл
+    file->data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->data == MAP_FAILED) {
+        *status = ALLOC_FAILED;
+        free(file);
+        return NULL;
+    }
+
+    // Проходим по записям, проверяя заголовки и то, что значения целиком помещаются в файл
+    size_t offset = 0, capacity = 0;
+    while (offset < file->size) {
+        MatrixFileHeader *header = (MatrixFileHeader *) (file->data + offset);
+        if (file->size - offset < sizeof(*header) || memcmp(header->magic, MATRIX_FILE_MAGIC, 4) != 0 ||
+            header->version != MATRIX_FILE_VERSION || header->dtype_size != sizeof(data_t) ||
+            (header->col != 0 && header->row > (file->size - offset) / sizeof(data_t) / header->col) ||
+            record_size(header->row, header->col) > file->size - offset) {
+            *status = INCORRECT_ARGS;
+            close_matrix_file(file);
+            return NULL;
+        }
+        if (file->count == capacity) {
+            capacity = capacity != 0 ? 2 * capacity : 4;
+            size_t *offsets = realloc(file->offsets, capacity * sizeof(*offsets));
+            if (offsets == NULL) {
+                *status = ALLOC_FAILED;
+                close_matrix_file(file);
+                return NULL;
+            }
+            file->offsets = offsets;
+        }
+        file->offsets[file->count++] = offset;
+        offset += record_size(header->row, header->col);
+    }
+
+    // Значения будут читаться последовательно
+    madvise(file->data, file->size, MADV_SEQUENTIAL);
+    *status = OK;
+    return file;
+}
+
+void close_matrix_file(MatrixFile *file) {
+    if (file == NULL) {
+        return;
+    }
+    munmap(file->data, file->size);
+    free(file->offsets);
+    free(file);
+}
+
+Matrix *matrix_file_get(MatrixFile *file, size_t index, int *status) {
+    if (file == NULL || index >= file->count) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    MatrixFileHeader *header = (MatrixFileHeader *) (file->data + file->offsets[index]);
+    Matrix *matrix = malloc(sizeof(*matrix));
+    if (matrix == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    // Строки в файле не дополняются, поэтому шаг строк равен их длине
+    matrix->row = header->row;
+    matrix->col = header->col;
+    matrix->stride = header->col;
+    matrix->storage = STORAGE_MAPPED;
+    matrix->values = (data_t *) (header + 1);
+    *status = OK;
+    return matrix;
+}
+
+int write_matrix_binary(FILE *file, Matrix *matrix) {
+    MatrixFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_FILE_MAGIC, 4);
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype_size = sizeof(data_t);
+    header.row = matrix->row;
+    header.col = matrix->col;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        return INCORRECT_ARGS;
+    }
+    for (size_t i = 0; i < matrix->row; i++) { // Дополнение строк в памяти не записывается
+        if (fwrite(matrix->values + i * matrix->stride, sizeof(data_t), matrix->col, file) != matrix->col) {
+            return INCORRECT_ARGS;
+        }
+    }
+    static const unsigned char zeros[MATRIX_ALIGNMENT];
+    size_t data_size = matrix->row * matrix->col * sizeof(data_t);
+    if (fwrite(zeros, 1, MATRIX_ALIGN_UP(data_size) - data_size, file) != MATRIX_ALIGN_UP(data_size) - data_size) {
+        return INCORRECT_ARGS;
+    }
+    return OK;
+}
+
+// Кратчайшая запись числа, однозначно восстанавливающая его значение (алгоритм Grisu2). Число v
+// представляется как f * 2^e, домножается на подходящую степень десяти из таблицы так, чтобы двоичный порядок
+// оказался в [SHORTEST_ALPHA, SHORTEST_GAMMA], после чего цифры выделяются целочисленными операциями
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+typedef struct {
+    uint64_t f;
+    int e;
+    int k;
+} CachedPower;
+
+#define SHORTEST_ALPHA (-60)
+#define SHORTEST_GAMMA (-32)
+
+// Степени 10^k для k = -300, -292, ..., 324 с 64-битной мантиссой
+static const CachedPower cached_powers[] = {
+        {UINT64_C(0xAB70FE17C79AC6CA), -1060, -300}, {UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292},
+        {UINT64_C(0xBE5691EF416BD60C), -1007, -284}, {UINT64_C(0x8DD01FAD907FFC3C), -980, -276},
+        {UINT64_C(0xD3515C2831559A83), -954, -268}, {UINT64_C(0x9D71AC8FADA6C9B5), -927, -260},
+        {UINT64_C(0xEA9C227723EE8BCB), -901, -252}, {UINT64_C(0xAECC49914078536D), -874, -244},
+        {UINT64_C(0x823C12795DB6CE57), -847, -236}, {UINT64_C(0xC21094364DFB5637), -821, -228},
+        {UINT64_C(0x9096EA6F3848984F), -794, -220}, {UINT64_C(0xD77485CB25823AC7), -768, -212},
+        {UINT64_C(0xA086CFCD97BF97F4), -741, -204}, {UINT64_C(0xEF340A98172AACE5), -715, -196},
+        {UINT64_C(0xB23867FB2A35B28E), -688, -188}, {UINT64_C(0x84C8D4DFD2C63F3B), -661, -180},
+        {UINT64_C(0xC5DD44271AD3CDBA), -635, -172}, {UINT64_C(0x936B9FCEBB25C996), -608, -164},
+        {UINT64_C(0xDBAC6C247D62A584), -582, -156}, {UINT64_C(0xA3AB66580D5FDAF6), -555, -148},
+        {UINT64_C(0xF3E2F893DEC3F126), -529, -140}, {UINT64_C(0xB5B5ADA8AAFF80B8), -502, -132},
+        {UINT64_C(0x87625F056C7C4A8B), -475, -124}, {UINT64_C(0xC9BCFF6034C13053), -449, -116},
+        {UINT64_C(0x964E858C91BA2655), -422, -108}, {UINT64_C(0xDFF9772470297EBD), -396, -100},
+        {UINT64_C(0xA6DFBD9FB8E5B88F), -369, -92}, {UINT64_C(0xF8A95FCF88747D94), -343, -84},
+        {UINT64_C(0xB94470938FA89BCF), -316, -76}, {UINT64_C(0x8A08F0F8BF0F156B), -289, -68},
+        {UINT64_C(0xCDB02555653131B6), -263, -60}, {UINT64_C(0x993FE2C6D07B7FAC), -236, -52},
+        {UINT64_C(0xE45C10C42A2B3B06), -210, -44}, {UINT64_C(0xAA242499697392D3), -183, -36},
+        {UINT64_C(0xFD87B5F28300CA0E), -157, -28}, {UINT64_C(0xBCE5086492111AEB), -130, -20},
+        {UINT64_C(0x8CBCCC096F5088CC), -103, -12}, {UINT64_C(0xD1B71758E219652C), -77, -4},
+        {UINT64_C(0x9C40000000000000), -50, 4}, {UINT64_C(0xE8D4A51000000000), -24, 12},
+        {UINT64_C(0xAD78EBC5AC620000), 3, 20}, {UINT64_C(0x813F3978F8940984), 30, 28},
+        {UINT64_C(0xC097CE7BC90715B3), 56, 36}, {UINT64_C(0x8F7E32CE7BEA5C70), 83, 44},
+        {UINT64_C(0xD5D238A4ABE98068), 109, 52}, {UINT64_C(0x9F4F2726179A2245), 136, 60},
+        {UINT64_C(0xED63A231D4C4FB27), 162, 68}, {UINT64_C(0xB0DE65388CC8ADA8), 189, 76},
+        {UINT64_C(0x83C7088E1AAB65DB), 216, 84}, {UINT64_C(0xC45D1DF942711D9A), 242, 92},
+        {UINT64_C(0x924D692CA61BE758), 269, 100}, {UINT64_C(0xDA01EE641A708DEA), 295, 108},
+        {UINT64_C(0xA26DA3999AEF774A), 322, 116}, {UINT64_C(0xF209787BB47D6B85), 348, 124},
+        {UINT64_C(0xB454E4A179DD1877), 375, 132}, {UINT64_C(0x865B86925B9BC5C2), 402, 140},
+        {UINT64_C(0xC83553C5C8965D3D), 428, 148}, {UINT64_C(0x952AB45CFA97A0B3), 455, 156},
+        {UINT64_C(0xDE469FBD99A05FE3), 481, 164}, {UINT64_C(0xA59BC234DB398C25), 508, 172},
+        {UINT64_C(0xF6C69A72A3989F5C), 534, 180}, {UINT64_C(0xB7DCBF5354E9BECE), 561, 188},
+        {UINT64_C(0x88FCF317F22241E2), 588, 196}, {UINT64_C(0xCC20CE9BD35C78A5), 614, 204},
+        {UINT64_C(0x98165AF37B2153DF), 641, 212}, {UINT64_C(0xE2A0B5DC971F303A), 667, 220},
+        {UINT64_C(0xA8D9D1535CE3B396), 694, 228}, {UINT64_C(0xFB9B7CD9A4A7443C), 720, 236},
+        {UINT64_C(0xBB764C4CA7A44410), 747, 244}, {UINT64_C(0x8BAB8EEFB6409C1A), 774, 252},
+        {UINT64_C(0xD01FEF10A657842C), 800, 260}, {UINT64_C(0x9B10A4E5E9913129), 827, 268},
+        {UINT64_C(0xE7109BFBA19C0C9D), 853, 276}, {UINT64_C(0xAC2820D9623BF429), 880, 284},
+        {UINT64_C(0x80444B5E7AA7CF85), 907, 292}, {UINT64_C(0xBF21E44003ACDD2D), 933, 300},
+        {UINT64_C(0x8E679C2F5E44FF8F), 960, 308}, {UINT64_C(0xD433179D9C8CB841), 986, 316},
+        {UINT64_C(0x9E19DB92B4E31BA9), 1013, 324},
+};
+
+static DiyFp diy_mul(DiyFp x, DiyFp y)
+{
+    unsigned __int128 p = (unsigned __int128) x.f * y.f;
+    uint64_t h = (uint64_t) (p >> 64);
+    h += ((uint64_t) p) >> 63; // Округление отбрасываемой младшей половины
+    return (DiyFp) {h, x.e + y.e + 64};
+}
+
+static DiyFp diy_normalize(DiyFp x)
+{
+    int shift = __builtin_clzll(x.f);
+    return (DiyFp) {x.f << shift, x.e - shift};
+}
+
+static void grisu2_round(char *buffer, size_t length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+    // Последняя цифра уменьшается, пока число остаётся в интервале округления и приближается к точному значению
+    while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buffer[length - 1]--;
+        rest += ten_k;
+    }
+}
+
+static size_t grisu2_digits(char *buffer, int *exponent, DiyFp m_minus, DiyFp w, DiyFp m_plus)
+{
+    uint64_t delta = m_plus.f - m_minus.f;
+    uint64_t dist = m_plus.f - w.f;
+    int shift = -m_plus.e;
+    uint64_t one = UINT64_C(1) << shift;
+    uint32_t p1 = (uint32_t) (m_plus.f >> shift);
+    uint64_t p2 = m_plus.f & (one - 1);
+
+    uint32_t pow10 = 1;
+    int n = 1;
+    while (n < 10 && p1 / pow10 >= 10) {
+        pow10 *= 10;
+        n++;
+    }
+
+    size_t length = 0;
+    // Цифры целой части
+    while (n > 0) {
+        buffer[length++] = (char) ('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        uint64_t rest = ((uint64_t) p1 << shift) + p2;
+        if (rest <= delta) {
+            *exponent += n;
+            grisu2_round(buffer, length, dist, delta, rest, (uint64_t) pow10 << shift);
+            return length;
+        }
+        pow10 /= 10;
+    }
+    // Цифры дробной части
+    int m = 0;
+    do {
+        p2 *= 10;
+        delta *= 10;
+        dist *= 10;
+        buffer[length++] = (char) ('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+    } while (p2 > delta);
+    *exponent -= m;
+    grisu2_round(buffer, length, dist, delta, p2, one);
+    return length;
+}
+
+// Записывает в buffer цифры кратчайшего представления положительного конечного числа, value = digits * 10^exponent
+static size_t grisu2(char *buffer, int *exponent, data_t value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t fraction = bits & ((UINT64_C(1) << 52) - 1);
+    int biased = (int) (bits >> 52) & 0x7ff;
+    DiyFp v = biased == 0 ? (DiyFp) {fraction, 1 - 1075} : (DiyFp) {fraction | (UINT64_C(1) << 52), biased - 1075};
+
+    // Границы интервала значений, которые округляются к value
+    DiyFp m_plus = diy_normalize((DiyFp) {2 * v.f + 1, v.e - 1});
+    DiyFp m_minus = fraction == 0 && biased > 1 ? (DiyFp) {4 * v.f - 1, v.e - 2} : (DiyFp) {2 * v.f - 1, v.e - 1};
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e = m_plus.e;
+    v = diy_normalize(v);
+
+    int f = SHORTEST_ALPHA - m_plus.e - 1;
+    int k = f * 78913 / (1 << 18) + (f > 0); // ceil(f * log10(2))
+    const CachedPower *cached = &cached_powers[(300 + k + 7) / 8];
+    DiyFp c = {cached->f, cached->e};
+
+    DiyFp w = diy_mul(v, c);
+    DiyFp w_minus = diy_mul(m_minus, c);
+    DiyFp w_plus = diy_mul(m_plus, c);
+    // Интервал сужается на единицу младшего разряда с каждой стороны, чтобы учесть погрешность умножения
+    w_minus.f++;
+    w_plus.f--;
+    *exponent = -cached->k;
+    return grisu2_digits(buffer, exponent, w_minus, w, w_plus);
+}
+
+size_t format_shortest(data_t value, char *buffer) {
+    char *p = buffer;
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (isnan(value)) {
+        memcpy(p, "nan", 4);
+        return (size_t) (p - buffer) + 3;
+    }
+    if (isinf(value)) {
+        memcpy(p, "inf", 4);
+        return (size_t) (p - buffer) + 3;
+    }
+    if (!(value > 0.0)) {
+        memcpy(p, "0", 2);
+        return (size_t) (p - buffer) + 1;
+    }
+
+    char digits[20];
+    int exponent;
+    int length = (int) grisu2(digits, &exponent, value);
+    int point = length + exponent; // Позиция десятичной точки относительно первой цифры
+
+    if (point > 0 && point <= 21) {
+        if (point >= length) { // Целое число: цифры и нули
+            memcpy(p, digits, (size_t) length);
+            memset(p + length, '0', (size_t) (point - length));
+            p += point;
+        } else {
+            memcpy(p, digits, (size_t) point);
+            p[point] = '.';
+            memcpy(p + point + 1, digits + point, (size_t) (length - point));
+            p += length + 1;
+        }
+    } else if (point <= 0 && point > -6) { // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', (size_t) -point);
+        p += -point;
+        memcpy(p, digits, (size_t) length);
+        p += length;
+    } else { // d.ddde+XX
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t) (length - 1));
+            p += length - 1;
+        }
+        int e = point - 1;
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        e = abs(e);
+        if (e >= 100) {
+            *p++ = (char) ('0' + e / 100);
+            e %= 100;
+            *p++ = (char) ('0' + e / 10);
+        } else if (e >= 10) {
+            *p++ = (char) ('0' + e / 10);
+        }
+        *p++ = (char) ('0' + e % 10);
+    }
+    *p = '\0';
+    return (size_t) (p - buffer);
+}
+
+// Буфер вывода: элементы форматируются в память и передаются в поток крупными блоками
+#define WRITE_BUFFER_SIZE (1 << 16)
+// Наибольшая длина числа в формате %10.5f: до 309 цифр целой части, знак, точка и дробная часть
+#define FIXED_BUFFER_SIZE 320
+
+typedef struct {
+    FILE *file;
+    size_t len;
+    char buffer[WRITE_BUFFER_SIZE];
+} TextWriter;
+
+static _Thread_local TextWriter output_writer;
+
+static TextWriter *start_writer(FILE *file)
+{
+    output_writer.file = file;
+    output_writer.len = 0;
+    return &output_writer;
+}
+
+static void flush_writer(TextWriter *writer)
+{
+    fwrite(writer->buffer, 1, writer->len, writer->file);
+    writer->len = 0;
+}
+
+// Гарантирует, что в буфере есть место для size байт
+static char *reserve(TextWriter *writer, size_t size)
+{
+    if (writer->len + size > WRITE_BUFFER_SIZE) {
+        flush_writer(writer);
+    }
+    return writer->buffer + writer->len;
+}
+
+static void write_string(TextWriter *writer, const char *string)
+{
+    size_t length = strlen(string);
+    memcpy(reserve(writer, length), string, length);
+    writer->len += length;
+}
+
+static void write_shortest(TextWriter *writer, data_t value)
+{
+    writer->len += format_shortest(value, reserve(writer, SHORTEST_BUFFER_SIZE));
+}
+
+void print_matrix(FILE *file, Matrix *matrix, int format) {
+    if (format == FORMAT_BINARY) {
+        write_matrix_binary(file, matrix);
+        return;
+    }
+    TextWriter *writer = start_writer(file);
+    if (format == FORMAT_HUMAN) {
+        for (size_t i = 0; i < matrix->row; i++) {
+            for (size_t j = 0; j < matrix->col; j++) {
+                // Фиксированная точность по-прежнему форматируется библиотекой, но без блокировки потока
+                // на каждый элемент
+                writer->len += (size_t) snprintf(reserve(writer, FIXED_BUFFER_SIZE), FIXED_BUFFER_SIZE,
+                                                 "%10.5" PR_DATA_T " ", matrix->values[j + matrix->stride * i]);
+            }
+            write_string(writer, "\n");
+        }
+    } else {
+        write_string(writer, "{");
+        for (size_t i = 0; i < matrix->row; i++) {
+            write_string(writer, "{");
+            for (size_t j = 0; j < matrix->col; j++) {
+                write_shortest(writer, matrix->values[j + matrix->stride * i]);
+                if (j != matrix->col - 1) {
+                    write_string(writer, ", ");
+                }
+            }
+            write_string(writer, i != matrix->row - 1 ? "}," : "}");
+        }
+        write_string(writer, "}\n");
+    }
+    flush_writer(writer);
+}
+
+// Размер буфера чтения и наибольшая длина числа в тексте
+#define TEXT_BUFFER_SIZE (1 << 20)
+#define MAX_TOKEN 128
+
+TextReader *new_text_reader(FILE *file) {
+    TextReader *reader = malloc(sizeof(*reader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    reader->buffer = malloc(TEXT_BUFFER_SIZE);
+    if (reader->buffer == NULL) {
+        free(reader);
+        return NULL;
+    }
+    reader->file = file;
+    reader->pos = 0;
+    reader->len = 0;
+    reader->eof = 0;
+    return reader;
+}
+
+void free_text_reader(TextReader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+    free(reader->buffer);
+    free(reader);
+}
+
+static void refill(TextReader *reader)
+{
+    // Непрочитанный остаток переносится в начало буфера, чтобы число не разрывалось на границе чтения
+    memmove(reader->buffer, reader->buffer + reader->pos, reader->len - reader->pos);
+    reader->len -= reader->pos;
+    reader->pos = 0;
+    size_t got = fread(reader->buffer + reader->len, 1, TEXT_BUFFER_SIZE - reader->len, reader->file);
+    if (got == 0) {
+        reader->eof = 1;
+    }
+    reader->len += got;
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Пропускает пробельные символы и гарантирует, что следующее число целиком находится в буфере
+static int next_token(TextReader *reader)
+{
+    for (;;) {
+        while (reader->pos < reader->len && is_space(reader->buffer[reader->pos])) {
+            reader->pos++;
+        }
+        if (reader->pos < reader->len && (reader->len - reader->pos >= MAX_TOKEN || reader->eof)) {
+            return 1;
+        }
+        if (reader->eof) {
+            return 0;
+        }
+        refill(reader);
+    }
+}
+
+static size_t token_length(TextReader *reader)
+{
+    size_t end = reader->pos;
+    while (end < reader->len && end - reader->pos < MAX_TOKEN && !is_space(reader->buffer[end])) {
+        end++;
+    }
+    return end - reader->pos;
+}
+
+static const data_t exact_powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int read_value(TextReader *reader, data_t *value) {
+    if (!next_token(reader)) {
+        return 0;
+    }
+    size_t length = token_length(reader);
+    const char *p = reader->buffer + reader->pos, *end = p + length;
+
+    // Быстрый путь: мантисса не длиннее 2^53 и порядок не больше 22 -- тогда произведение или частное
+    // двух точно представимых чисел округляется правильно
+    _Bool negative = 0, fast = 1;
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+    const char *digits_start = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            fast = 0;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            } else {
+                fast = 0;
+            }
+        }
+    }
+    if (p == digits_start) {
+        fast = 0; // inf, nan и прочие нечисловые записи
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        _Bool exp_negative = 0;
+        int exp_value = 0;
+        p++;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exp_negative = *p++ == '-';
+        }
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (exp_value < 10000) {
+                exp_value = exp_value * 10 + (*p - '0');
+            }
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+    if (fast && p == end && mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+        data_t result = (data_t) mantissa;
+        result = exponent < 0 ? result / exact_powers[-exponent] : result * exact_powers[exponent];
+        *value = negative ? -result : result;
+        reader->pos += length;
+        return 1;
+    }
+
+    // Остальные случаи разбираются стандартной библиотекой
+    char token[MAX_TOKEN + 1];
+    memcpy(token, reader->buffer + reader->pos, length);
+    token[length] = '\0';
+    char *parsed_end;
+    *value = strtod(token, &parsed_end);
+    if (parsed_end == token) {
+        return 0;
+    }
+    reader->pos += length;
+    return 1;
+}
+
+int read_size(TextReader *reader, size_t *value) {
+    if (!next_token(reader)) {
+        return 0;
+    }
+    size_t length = token_length(reader);
+    const char *p = reader->buffer + reader->pos;
+    size_t result = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return 0;
+        }
+        result = result * 10 + (size_t) (p[i] - '0');
+    }
+    reader->pos += length;
+    *value = result;
+    return length != 0;
+}
+
+int convert_text_to_binary(FILE *in, FILE *out, size_t n) {
+    // Текстовый формат ручного ввода: n * n элементов матрицы A, затем n элементов столбца f
+    TextReader *reader = new_text_reader(in);
+    Matrix *a = new_matrix(n, n);
+    Matrix *f = new_matrix(n, 1);
+    int status = OK;
+    if (reader == NULL || a == NULL || f == NULL) {
+        status = ALLOC_FAILED;
+    }
+    for (size_t i = 0; status == OK && i < n * n; i++) {
+        data_t in_value;
+        if (!read_value(reader, &in_value)) {
+            status = INCORRECT_ARGS;
+            break;
+        }
+        set_element(a, i / n, i % n, in_value);
+    }
+    for (size_t i = 0; status == OK && i < n; i++) {
+        data_t in_value;
+        if (!read_value(reader, &in_value)) {
+            status = INCORRECT_ARGS;
+            break;
+        }
+        set_element(f, i, 0, in_value);
+    }
+    if (status == OK && (status = write_matrix_binary(out, a)) == OK) {
+        status = write_matrix_binary(out, f);
+    }
+    free_text_reader(reader);
+    free_matrix(a);
+    free_matrix(f);
+    return status;
+}
+
+int convert_binary_to_text(const char *path, FILE *out) {
+    int status;
+    MatrixFile *file = open_matrix_file(path, &status);
+    if (file == NULL) {
+        return status;
+    }
+    // Все записи выводятся подряд кратчайшей записью, достаточной для точного обратного преобразования
+    TextWriter *writer = start_writer(out);
+    for (size_t k = 0; k < file->count && status == OK; k++) {
+        Matrix *matrix = matrix_file_get(file, k, &status);
+        if (matrix == NULL) {
+            break;
+        }
+        for (size_t i = 0; i < matrix->row; i++) {
+            for (size_t j = 0; j < matrix->col; j++) {
+                write_shortest(writer, get_element(matrix, i, j));
+                write_string(writer, j + 1 < matrix->col ? " " : "\n");
+            }
+        }
+        free_matrix(matrix);
+    }
+    flush_writer(writer);
+    close_matrix_file(file);
+    return status;
+}
@@ -0,0 +1,77 @@
+#ifndef LE_SOLVER_IO_H
+#define LE_SOLVER_IO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "matrix.h"
+
+// Двоичный формат: последовательность записей, каждая из заголовка и значений матрицы по строкам в формате data_t
+// с порядком байт машины. Записи выровнены по 64 байтам, поэтому при отображении файла в память значения
+// выровнены так же, как у матриц, созданных new_matrix
+#define MATRIX_FILE_MAGIC "LESM"
+#define MATRIX_FILE_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t dtype_size; // sizeof(data_t) записавшей программы
+    uint32_t reserved;
+    uint64_t row;
+    uint64_t col;
+    unsigned char padding[32];
+} MatrixFileHeader;
+
+// Отображённый в память двоичный файл. Матрицы, полученные из него, используют значения из файла без
+// копирования и действительны, пока файл не закрыт
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t count;
+    size_t *offsets;
+} MatrixFile;
+
+MatrixFile *open_matrix_file(const char *path, int *status);
+
+void close_matrix_file(MatrixFile *file);
+
+Matrix *matrix_file_get(MatrixFile *file, size_t index, int *status);
+
+int write_matrix_binary(FILE *file, Matrix *matrix);
+
+// Буферизованное чтение чисел из текстового потока без вызова scanf на каждый элемент
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t pos;
+    size_t len;
+    _Bool eof;
+} TextReader;
+
+TextReader *new_text_reader(FILE *file);
+
+void free_text_reader(TextReader *reader);
+
+int read_value(TextReader *reader, data_t *value);
+
+int read_size(TextReader *reader, size_t *value);
+
+// Форматы вывода матриц
+enum {
+    FORMAT_HUMAN = 0, // Выровненные столбцы с пятью знаками после запятой
+    FORMAT_MACHINE,   // {{a, b},{c, d}} с кратчайшей записью, точно восстанавливающей значения
+    FORMAT_BINARY     // Записи двоичного формата, которые читает open_matrix_file
+};
+
+// Наибольшая длина кратчайшей записи числа вместе с завершающим нулём
+#define SHORTEST_BUFFER_SIZE 32
+
+size_t format_shortest(data_t value, char *buffer);
+
+void print_matrix(FILE *file, Matrix *matrix, int format);
+
+int convert_text_to_binary(FILE *in, FILE *out, size_t n);
+
+int convert_binary_to_text(const char *path, FILE *out);
+
+#endif //LE_SOLVER_IO_H
@@ -0,0 +1,534 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "krylov.h"
+#include "error.h"
+
+void dense_matvec(void *matrix, const data_t *x, data_t *y) {
+    Matrix *a = matrix;
+    for (size_t i = 0; i < a->row; i++) {
+        data_t sum = 0.0;
+        for (size_t j = 0; j < a->col; j++) {
+            sum += get_element(a, i, j) * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+void sparse_matvec(void *matrix, const data_t *x, data_t *y) {
+    sparse_mul_vector(matrix, x, y);
+}
+
+typedef struct {
+    SparseMatrix *matrix;
+    _Bool owns_matrix;
+    size_t *diagonal; // Позиции диагональных элементов в строках matrix
+    data_t *inverse_diagonal;
+    data_t omega;
+} SparsePreconditioner;
+
+static void release_sparse_preconditioner(void *context)
+{
+    SparsePreconditioner *pc = context;
+    if (pc->owns_matrix) {
+        free_sparse_matrix(pc->matrix);
+    }
+    free(pc->diagonal);
+    free(pc->inverse_diagonal);
+    free(pc);
+}
+
+static Preconditioner *new_sparse_preconditioner(SparseMatrix *a, void (*apply)(void *, const data_t *, data_t *),
+                                                 int *status)
+{
+    if (a == NULL || a->row != a->col) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Preconditioner *preconditioner = malloc(sizeof(*preconditioner));
+    SparsePreconditioner *pc = calloc(1, sizeof(*pc));
+    if (preconditioner == NULL || pc == NULL) {
+        *status = ALLOC_FAILED;
+        free(preconditioner);
+        free(pc);
+        return NULL;
+    }
+    preconditioner->apply = apply;
+    preconditioner->release = release_sparse_preconditioner;
+    preconditioner->context = pc;
+    pc->matrix = a;
+    pc->diagonal = malloc((a->row != 0 ? a->row : 1) * sizeof(*pc->diagonal));
+    pc->inverse_diagonal = malloc((a->row != 0 ? a->row : 1) * sizeof(*pc->inverse_diagonal));
+    if (pc->diagonal == NULL || pc->inverse_diagonal == NULL) {
+        *status = ALLOC_FAILED;
+        free_preconditioner(preconditioner);
+        return NULL;
+    }
+    for (size_t i = 0; i < a->row; i++) {
+        pc->diagonal[i] = a->nnz;
+        for (size_t k = a->row_start[i]; k < a->row_start[i + 1]; k++) {
+            if (a->col_idx[k] == i) {
+                pc->diagonal[i] = k;
+            }
+        }
+        // Все предобусловливатели делят на диагональные элементы, поэтому они должны быть ненулевыми
+        if (pc->diagonal[i] == a->nnz || !(fabs(a->values[pc->diagonal[i]]) > 0.0)) {
+            *status = INCORRECT_ARGS;
+            free_preconditioner(preconditioner);
+            return NULL;
+        }
+        pc->inverse_diagonal[i] = 1.0 / a->values[pc->diagonal[i]];
+    }
+    *status = OK;
+    return preconditioner;
+}
+
+void free_preconditioner(Preconditioner *preconditioner) {
+    if (preconditioner == NULL) {
+        return;
+    }
+    preconditioner->release(preconditioner->context);
+    free(preconditioner);
+}
+
+static void jacobi_apply(void *context, const data_t *r, data_t *z)
+{
+    SparsePreconditioner *pc = context;
+    for (size_t i = 0; i < pc->matrix->row; i++) {
+        z[i] = r[i] * pc->inverse_diagonal[i];
+    }
+}
+
+Preconditioner *jacobi_preconditioner(SparseMatrix *a, int *status) {
+    return new_sparse_preconditioner(a, jacobi_apply, status);
+}
+
+static void ssor_apply(void *context, const data_t *r, data_t *z)
+{
+    // M = (D + w * L) * D^-1 * (D + w * U) / (w * (2 - w))
+    SparsePreconditioner *pc = context;
+    SparseMatrix *a = pc->matrix;
+    data_t omega = pc->omega;
+    for (size_t i = 0; i < a->row; i++) { // (D + w * L) * y = r
+        data_t sum = r[i];
+        for (size_t k = a->row_start[i]; k < pc->diagonal[i]; k++) {
+            sum -= omega * a->values[k] * z[a->col_idx[k]];
+        }
+        z[i] = sum * pc->inverse_diagonal[i];
+    }
+    for (size_t i = a->row; i > 0; i--) { // (D + w * U) * z = D * y
+        size_t row = i - 1;
+        data_t sum = z[row] * a->values[pc->diagonal[row]];
+        for (size_t k = pc->diagonal[row] + 1; k < a->row_start[row + 1]; k++) {
+            sum -= omega * a->values[k] * z[a->col_idx[k]];
+        }
+        z[row] = sum * pc->inverse_diagonal[row];
+    }
+    // Множитель применяется после обратного хода, т.к. в нём используются ещё не масштабированные z
+    data_t scale = omega * (2.0 - omega);
+    for (size_t i = 0; i < a->row; i++) {
+        z[i] *= scale;
+    }
+}
+
+Preconditioner *ssor_preconditioner(SparseMatrix *a, data_t omega, int *status) {
+    // Матрица не копируется и должна существовать, пока используется предобусловливатель
+    Preconditioner *preconditioner = new_sparse_preconditioner(a, ssor_apply, status);
+    if (preconditioner != NULL) {
+        ((SparsePreconditioner *) preconditioner->context)->omega = omega;
+    }
+    return preconditioner;
+}
+
+static void ilu0_apply(void *context, const data_t *r, data_t *z)
+{
+    SparsePreconditioner *pc = context;
+    SparseMatrix *lu = pc->matrix;
+    for (size_t i = 0; i < lu->row; i++) { // L * y = r, диагональ L единичная
+        data_t sum = r[i];
+        for (size_t k = lu->row_start[i]; k < pc->diagonal[i]; k++) {
+            sum -= lu->values[k] * z[lu->col_idx[k]];
+        }
+        z[i] = sum;
+    }
+    for (size_t i = lu->row; i > 0; i--) { // U * z = y
+        size_t row = i - 1;
+        data_t sum = z[row];
+        for (size_t k = pc->diagonal[row] + 1; k < lu->row_start[row + 1]; k++) {
+            sum -= lu->values[k] * z[lu->col_idx[k]];
+        }
+        z[row] = sum / lu->values[pc->diagonal[row]];
+    }
+}
+
+Preconditioner *ilu0_preconditioner(SparseMatrix *a, int *status) {
+    if (a == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    SparseMatrix *lu = copy_sparse_matrix(a);
+    if (lu == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    Preconditioner *preconditioner = new_sparse_preconditioner(lu, ilu0_apply, status);
+    if (preconditioner == NULL) {
+        free_sparse_matrix(lu);
+        return NULL;
+    }
+    SparsePreconditioner *pc = preconditioner->context;
+    pc->owns_matrix = 1;
+    size_t *position = malloc((lu->col != 0 ? lu->col : 1) * sizeof(*position));
+    if (position == NULL) {
+        *status = ALLOC_FAILED;
+        free_preconditioner(preconditioner);
+        return NULL;
+    }
+    for (size_t j = 0; j < lu->col; j++) {
+        position[j] = lu->nnz;
+    }
+
+    // Неполное LU-разложение: исключение выполняется только в позициях ненулевых элементов исходной матрицы
+    for (size_t i = 0; i < lu->row; i++) {
+        for (size_t k = lu->row_start[i]; k < lu->row_start[i + 1]; k++) {
+            position[lu->col_idx[k]] = k;
+        }
+        for (size_t k = lu->row_start[i]; k < pc->diagonal[i]; k++) {
+            size_t row = lu->col_idx[k];
+            lu->values[k] /= lu->values[pc->diagonal[row]];
+            for (size_t t = pc->diagonal[row] + 1; t < lu->row_start[row + 1]; t++) {
+                if (position[lu->col_idx[t]] != lu->nnz) {
+                    lu->values[position[lu->col_idx[t]]] -= lu->values[k] * lu->values[t];
+                }
+            }
+        }
+        for (size_t k = lu->row_start[i]; k < lu->row_start[i + 1]; k++) {
+            position[lu->col_idx[k]] = lu->nnz;
+        }
+        if (!(fabs(lu->values[pc->diagonal[i]]) > 0.0)) { // Разложение не существует
+            *status = INCORRECT_ARGS;
+            free(position);
+            free_preconditioner(preconditioner);
+            return NULL;
+        }
+    }
+
+    free(position);
+    *status = OK;
+    return preconditioner;
+}
+
+typedef struct {
+    size_t n;
+    data_t *inverse_diagonal;
+} DiagonalPreconditioner;
+
+static void release_diagonal_preconditioner(void *context)
+{
+    DiagonalPreconditioner *pc = context;
+    free(pc->inverse_diagonal);
+    free(pc);
+}
+
+static void diagonal_apply(void *context, const data_t *r, data_t *z)
+{
+    DiagonalPreconditioner *pc = context;
+    for (size_t i = 0; i < pc->n; i++) {
+        z[i] = r[i] * pc->inverse_diagonal[i];
+    }
+}
+
+Preconditioner *operator_jacobi_preconditioner(Operator *a, int *status) {
+    if (a == NULL || a->diagonal == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Preconditioner *preconditioner = malloc(sizeof(*preconditioner));
+    DiagonalPreconditioner *pc = malloc(sizeof(*pc));
+    data_t *inverse_diagonal = malloc((a->n != 0 ? a->n : 1) * sizeof(*inverse_diagonal));
+    if (preconditioner == NULL || pc == NULL || inverse_diagonal == NULL) {
+        *status = ALLOC_FAILED;
+        free(preconditioner);
+        free(pc);
+        free(inverse_diagonal);
+        return NULL;
+    }
+    pc->n = a->n;
+    pc->inverse_diagonal = inverse_diagonal;
+    preconditioner->apply = diagonal_apply;
+    preconditioner->release = release_diagonal_preconditioner;
+    preconditioner->context = pc;
+    for (size_t i = 0; i < a->n; i++) {
+        data_t diagonal = a->diagonal(a->context, i);
+        if (!(fabs(diagonal) > 0.0)) {
+            *status = INCORRECT_ARGS;
+            free_preconditioner(preconditioner);
+            return NULL;
+        }
+        inverse_diagonal[i] = 1.0 / diagonal;
+    }
+    *status = OK;
+    return preconditioner;
+}
+
+static data_t dot(const data_t *x, const data_t *y, size_t n)
+{
+    data_t sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+static void precondition(Preconditioner *preconditioner, const data_t *r, data_t *z, size_t n)
+{
+    if (preconditioner == NULL) {
+        memcpy(z, r, n * sizeof(*z));
+    } else {
+        preconditioner->apply(preconditioner->context, r, z);
+    }
+}
+
+// Выделяет count векторов длины n одним блоком
+static data_t *new_vectors(size_t n, size_t count)
+{
+    return calloc(n * count + 1, sizeof(data_t));
+}
+
+Matrix *cg_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, data_t precision,
+                 size_t max_iters, size_t *iters, int *status) {
+    if (matvec == NULL || f == NULL || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = f->row;
+    Matrix *answ = new_matrix(n, 1);
+    data_t *work = new_vectors(n, 4);
+    if (answ == NULL || work == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(answ);
+        free(work);
+        return NULL;
+    }
+    data_t *x = answ->values, *r = work, *z = work + n, *p = work + 2 * n, *q = work + 3 * n;
+
+    // Метод сопряжённых градиентов с предобусловливанием, применим для симметричных положительно определённых A
+    memcpy(r, f->values, n * sizeof(*r)); // При нулевом начальном приближении r = f
+    precondition(preconditioner, r, z, n);
+    memcpy(p, z, n * sizeof(*p));
+    data_t rz = dot(r, z, n);
+    data_t f_norm = sqrt(dot(f->values, f->values, n));
+    *iters = 0;
+    while (*iters < max_iters && sqrt(dot(r, r, n)) > precision * f_norm) {
+        matvec(context, p, q);
+        data_t pq = dot(p, q, n);
+        if (!(fabs(pq) > 0.0)) {
+            break;
+        }
+        data_t alpha = rz / pq;
+        for (size_t i = 0; i < n; i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+        precondition(preconditioner, r, z, n);
+        data_t rz_next = dot(r, z, n);
+        data_t beta = rz_next / rz;
+        for (size_t i = 0; i < n; i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+        rz = rz_next;
+        (*iters)++;
+    }
+
+    *status = sqrt(dot(r, r, n)) > precision * f_norm ? NOT_CONVERGED : OK;
+    free(work);
+    return answ;
+}
+
+Matrix *bicgstab_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, data_t precision,
+                       size_t max_iters, size_t *iters, int *status) {
+    if (matvec == NULL || f == NULL || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = f->row;
+    Matrix *answ = new_matrix(n, 1);
+    data_t *work = new_vectors(n, 8);
+    if (answ == NULL || work == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(answ);
+        free(work);
+        return NULL;
+    }
+    data_t *x = answ->values, *r = work, *r0 = work + n, *p = work + 2 * n, *v = work + 3 * n, *s = work + 4 * n,
+           *t = work + 5 * n, *p_hat = work + 6 * n, *s_hat = work + 7 * n;
+
+    // Стабилизированный метод бисопряжённых градиентов с предобусловливанием справа
+    memcpy(r, f->values, n * sizeof(*r));
+    memcpy(r0, f->values, n * sizeof(*r0));
+    data_t rho = 1.0, alpha = 1.0, omega = 1.0;
+    data_t f_norm = sqrt(dot(f->values, f->values, n));
+    *iters = 0;
+    while (*iters < max_iters && sqrt(dot(r, r, n)) > precision * f_norm) {
+        data_t rho_next = dot(r0, r, n);
+        if (!(fabs(rho_next) > 0.0)) {
+            break;
+        }
+        data_t beta = (rho_next / rho) * (alpha / omega);
+        for (size_t i = 0; i < n; i++) {
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+        }
+        precondition(preconditioner, p, p_hat, n);
+        matvec(context, p_hat, v);
+        alpha = rho_next / dot(r0, v, n);
+        for (size_t i = 0; i < n; i++) {
+            s[i] = r[i] - alpha * v[i];
+        }
+        (*iters)++;
+        if (sqrt(dot(s, s, n)) <= precision * f_norm) { // Решение найдено за половину итерации
+            for (size_t i = 0; i < n; i++) {
+                x[i] += alpha * p_hat[i];
+            }
+            memcpy(r, s, n * sizeof(*r));
+            break;
+        }
+        precondition(preconditioner, s, s_hat, n);
+        matvec(context, s_hat, t);
+        data_t tt = dot(t, t, n);
+        omega = tt > 0.0 ? dot(t, s, n) / tt : 0.0;
+        for (size_t i = 0; i < n; i++) {
+            x[i] += alpha * p_hat[i] + omega * s_hat[i];
+            r[i] = s[i] - omega * t[i];
+        }
+        rho = rho_next;
+        if (!(fabs(omega) > 0.0)) {
+            break;
+        }
+    }
+
+    *status = sqrt(dot(r, r, n)) > precision * f_norm ? NOT_CONVERGED : OK;
+    free(work);
+    return answ;
+}
+
+Matrix *gmres_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, size_t restart,
+                    data_t precision, size_t max_iters, size_t *iters, int *status) {
+    if (matvec == NULL || f == NULL || f->col != 1 || restart == 0) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = f->row, m = restart;
+    Matrix *answ = new_matrix(n, 1);
+    data_t *basis = new_vectors(n, m + 1); // Ортонормированный базис подпространства Крылова
+    data_t *work = new_vectors(n, 2);
+    data_t *hessenberg = new_vectors(m, m + 1); // Верхняя матрица Хессенберга (m + 1) x m по строкам
+    data_t *rotations = new_vectors(m + 1, 4); // Косинусы и синусы вращений Гивенса, правая часть и решение
+    if (answ == NULL || basis == NULL || work == NULL || hessenberg == NULL || rotations == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(answ);
+        free(basis);
+        free(work);
+        free(hessenberg);
+        free(rotations);
+        return NULL;
+    }
+    data_t *x = answ->values, *w = work, *z = work + n;
+    data_t *cs = rotations, *sn = rotations + (m + 1), *g = rotations + 2 * (m + 1), *y = rotations + 3 * (m + 1);
+
+    // Метод обобщённых минимальных невязок с перезапуском через restart итераций и предобусловливанием справа
+    data_t f_norm = sqrt(dot(f->values, f->values, n));
+    data_t residual_norm = f_norm;
+    *iters = 0;
+    while (*iters < max_iters) {
+        matvec(context, x, w); // Невязка r = f - A * x вычисляется заново при каждом перезапуске
+        for (size_t i = 0; i < n; i++) {
+            w[i] = f->values[i] - w[i];
+        }
+        residual_norm = sqrt(dot(w, w, n));
+        if (residual_norm <= precision * f_norm) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            basis[i] = w[i] / residual_norm;
+        }
+        for (size_t i = 0; i <= m; i++) {
+            g[i] = 0.0;
+        }
+        g[0] = residual_norm;
+
+        size_t k = 0;
+        while (k < m && *iters < max_iters) {
+            data_t *v = basis + k * n, *v_next = basis + (k + 1) * n;
+            precondition(preconditioner, v, z, n);
+            matvec(context, z, w);
+            for (size_t i = 0; i <= k; i++) { // Модифицированный процесс Грама-Шмидта
+                data_t h = dot(w, basis + i * n, n);
+                hessenberg[i * m + k] = h;
+                for (size_t j = 0; j < n; j++) {
+                    w[j] -= h * basis[i * n + j];
+                }
+            }
+            data_t h_next = sqrt(dot(w, w, n));
+            hessenberg[(k + 1) * m + k] = h_next;
+            if (h_next > 0.0) {
+                for (size_t j = 0; j < n; j++) {
+                    v_next[j] = w[j] / h_next;
+                }
+            }
+
+            // Приводим новый столбец к верхнетреугольному виду накопленными и новым вращениями
+            for (size_t i = 0; i < k; i++) {
+                data_t tmp = cs[i] * hessenberg[i * m + k] + sn[i] * hessenberg[(i + 1) * m + k];
+                hessenberg[(i + 1) * m + k] = -sn[i] * hessenberg[i * m + k] + cs[i] * hessenberg[(i + 1) * m + k];
+                hessenberg[i * m + k] = tmp;
+            }
+            data_t denominator = hypot(hessenberg[k * m + k], hessenberg[(k + 1) * m + k]);
+            cs[k] = denominator > 0.0 ? hessenberg[k * m + k] / denominator : 1.0;
+            sn[k] = denominator > 0.0 ? hessenberg[(k + 1) * m + k] / denominator : 0.0;
+            hessenberg[k * m + k] = denominator;
+            hessenberg[(k + 1) * m + k] = 0.0;
+            g[k + 1] = -sn[k] * g[k];
+            g[k] = cs[k] * g[k];
+
+            k++;
+            (*iters)++;
+            if (fabs(g[k]) <= precision * f_norm || !(h_next > 0.0)) {
+                break;
+            }
+        }
+
+        // x = x + M^-1 * V * y, где y -- решение треугольной системы H * y = g
+        for (size_t i = k; i > 0; i--) {
+            data_t sum = g[i - 1];
+            for (size_t j = i; j < k; j++) {
+                sum -= hessenberg[(i - 1) * m + j] * y[j];
+            }
+            data_t diagonal = hessenberg[(i - 1) * m + (i - 1)];
+            y[i - 1] = fabs(diagonal) > 0.0 ? sum / diagonal : 0.0;
+        }
+        for (size_t j = 0; j < n; j++) {
+            w[j] = 0.0;
+        }
+        for (size_t i = 0; i < k; i++) {
+            for (size_t j = 0; j < n; j++) {
+                w[j] += y[i] * basis[i * n + j];
+            }
+        }
+        precondition(preconditioner, w, z, n);
+        for (size_t j = 0; j < n; j++) {
+            x[j] += z[j];
+        }
+        residual_norm = fabs(g[k]);
+        if (residual_norm <= precision * f_norm) {
+            break;
+        }
+    }
+
+    *status = residual_norm > precision * f_norm ? NOT_CONVERGED : OK;
+    free(basis);
+    free(work);
+    free(hessenberg);
+    free(rotations);
+    return answ;
+}
@@ -0,0 +1,42 @@
+#ifndef LE_SOLVER_KRYLOV_H
+#define LE_SOLVER_KRYLOV_H
+
+#include "matrix.h"
+#include "sparse.h"
+#include "operator.h"
+
+// Умножение матрицы системы на вектор: y = A * x
+typedef void (*matvec_t)(void *context, const data_t *x, data_t *y);
+
+// Предобусловливатель вычисляет z = M^-1 * r. Вместо отсутствующего предобусловливателя передаётся NULL
+typedef struct {
+    void (*apply)(void *context, const data_t *r, data_t *z);
+    void (*release)(void *context);
+    void *context;
+} Preconditioner;
+
+void dense_matvec(void *matrix, const data_t *x, data_t *y);
+
+void sparse_matvec(void *matrix, const data_t *x, data_t *y);
+
+Preconditioner *jacobi_preconditioner(SparseMatrix *a, int *status);
+
+Preconditioner *ssor_preconditioner(SparseMatrix *a, data_t omega, int *status);
+
+Preconditioner *ilu0_preconditioner(SparseMatrix *a, int *status);
+
+// Предобусловливатель Якоби по диагонали оператора
+Preconditioner *operator_jacobi_preconditioner(Operator *a, int *status);
+
+void free_preconditioner(Preconditioner *preconditioner);
+
+Matrix *cg_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, data_t precision,
+                 size_t max_iters, size_t *iters, int *status);
+
+Matrix *bicgstab_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, data_t precision,
+                       size_t max_iters, size_t *iters, int *status);
+
+Matrix *gmres_solve(matvec_t matvec, void *context, Matrix *f, Preconditioner *preconditioner, size_t restart,
+                    data_t precision, size_t max_iters, size_t *iters, int *status);
+
+#endif //LE_SOLVER_KRYLOV_H
@@ -0,0 +1,80 @@
+/*
+ * Шаблон ядер LU-разложения с выбором главного элемента по столбцу для плотной матрицы n x n, хранящейся по строкам
+ * с шагом lda. Перед подключением определяются KERNEL_TYPE -- тип элементов, KERNEL_ABS -- модуль для него и
+ * KERNEL_SUFFIX -- суффикс имён функций. Файл подключается по разу для каждого типа и отменяет эти макросы
+ */
+
+#define KERNEL_CONCAT_(name, suffix) name##suffix
+#define KERNEL_CONCAT(name, suffix) KERNEL_CONCAT_(name, suffix)
+#define KERNEL_NAME(name) KERNEL_CONCAT(name, KERNEL_SUFFIX)
+
+// Разложение P * A = L * U на месте, pivots[i] -- строка, переставленная с i-ой на i-ом шаге. Возвращает 0, если
+// встретился нулевой или нечисловой главный элемент
+static inline _Bool KERNEL_NAME(lu_kernel_factor)(KERNEL_TYPE *a, size_t n, size_t lda, size_t *pivots)
+{
+    for (size_t i = 0; i < n; i++) {
+        size_t pivot = i;
+        for (size_t j = i + 1; j < n; j++) {
+            if (KERNEL_ABS(a[j * lda + i]) > KERNEL_ABS(a[pivot * lda + i])) {
+                pivot = j;
+            }
+        }
+        pivots[i] = pivot;
+        if (!(KERNEL_ABS(a[pivot * lda + i]) > 0)) { // В том числе nan после переполнения
+            return 0;
+        }
+        if (pivot != i) {
+            for (size_t k = 0; k < n; k++) {
+                KERNEL_TYPE tmp = a[i * lda + k];
+                a[i * lda + k] = a[pivot * lda + k];
+                a[pivot * lda + k] = tmp;
+            }
+        }
+
+        const KERNEL_TYPE *pivot_row = a + i * lda;
+        // Строки хранятся непрерывно, поэтому внутренний цикл векторизуется на ширину регистра для KERNEL_TYPE
+        PARALLEL_FOR(num_threads(get_thread_count()) if((n - i) * (n - i) > PARALLEL_THRESHOLD) schedule(static))
+        for (size_t j = i + 1; j < n; j++) {
+            KERNEL_TYPE *row = a + j * lda;
+            KERNEL_TYPE coefficient = row[i] / pivot_row[i];
+            for (size_t k = i + 1; k < n; k++) {
+                row[k] -= coefficient * pivot_row[k];
+            }
+            row[i] = coefficient; // Множитель L сохраняется на месте занулённого элемента
+        }
+        PROFILE_COUNT((n - i - 1) * (2 * (n - i - 1) + 1), 0, 0);
+    }
+    return 1;
+}
+
+// Решение L * U * x = P * b на месте x, в начале x = b
+static inline void KERNEL_NAME(lu_kernel_solve)(const KERNEL_TYPE *lu, size_t n, size_t lda, const size_t *pivots,
+                                                KERNEL_TYPE *x)
+{
+    for (size_t i = 0; i < n; i++) {
+        KERNEL_TYPE tmp = x[i];
+        x[i] = x[pivots[i]];
+        x[pivots[i]] = tmp;
+    }
+    for (size_t i = 0; i < n; i++) {
+        KERNEL_TYPE sum = x[i];
+        for (size_t k = 0; k < i; k++) {
+            sum -= lu[i * lda + k] * x[k];
+        }
+        x[i] = sum;
+    }
+    for (size_t i = n; i > 0; i--) {
+        KERNEL_TYPE sum = x[i - 1];
+        for (size_t k = i; k < n; k++) {
+            sum -= lu[(i - 1) * lda + k] * x[k];
+        }
+        x[i - 1] = sum / lu[(i - 1) * lda + (i - 1)];
+    }
+}
+
+#undef KERNEL_NAME
+#undef KERNEL_CONCAT
+#undef KERNEL_CONCAT_
+#undef KERNEL_TYPE
+#undef KERNEL_ABS
+#undef KERNEL_SUFFIX
@@ -1,131 +1,474 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "matrix.h"
 #include "algs.h"
+#include "batch.h"
 #include "relaxation.h"
-
-extern int mode;
-
-data_t gen_function_a(size_t n, size_t m, size_t i, size_t j);
-data_t gen_function_f(size_t n, size_t m, size_t i);
+#include "krylov.h"
+#include "io.h"
+#include "generate.h"
+#include "structure.h"
+#include "cholesky.h"
+#include "mixed.h"
+#include "tiled.h"
+#include "server.h"
+#include "profile.h"
+#include "error.h"
 
 /*
  * Первый аргумент -- число 1 или 2 для выбора между методом Гаусса и методом верхней релакскации, соответственно
- * Второй аргумень -- число 1 или 2 для выбора формата вывода матрицы -- человекочитаемо или машинописно, соответственно
- * Третий аргумент -- число 1 или 2 для выбора ввода матрицы вручную или генерации при помощи функции
+ * Число 3 выбирает метод верхней релаксации с многоцветным упорядочиванием неизвестных, при котором неизвестные
+ * одного цвета вычисляются параллельно. Число 4 выбирает метод верхней релаксации, в котором матрица A^T * A
+ * не строится явно. Число 5 выбирает метод GMRES с перезапуском и предобусловливателем ILU(0). Число 6 выбирает
+ * симметричный метод верхней релаксации с ускорением Чебышёва. Число 7 выбирает метод Гаусса в смешанной точности
+ * Второй аргумень -- число 1, 2 или 3 для выбора формата вывода матрицы -- человекочитаемо, машинописно или
+ * в двоичном формате, соответственно. В двоичном формате на стандартный поток вывода записываются только матрицы,
+ * а подписи и остальные результаты выводятся на стандартный поток ошибок
+ * Третий аргумент -- число 1, 2, 3 или 4 для выбора ввода матрицы вручную, генерации при помощи функции, чтения
+ * из двоичного файла или генерации при помощи функции без хранения матрицы
  * Для случая задания матрицы вручную передаётся число n -- размер матрицы A и вектора-столбца f, которые
  * задаются на стандартном потоке ввода
- * Для случая генерации матрицы при помощи функции задаются два числа n и m
- * В случае выбора метода верхней релаксации последним аргументом ожидается параметр омега
+ * Для случая двоичного файла передаётся путь к файлу, первая запись которого -- матрица A, вторая -- столбец f
+ * Для случая генерации матрицы при помощи функции задаются два числа n и m. Без хранения матрицы память занимают
+ * только векторы длины n, поэтому доступны большие n, но из методов -- только 2 (одновременная верхняя
+ * релаксация) и 5 (GMRES с предобусловливателем Якоби), а сама матрица не выводится
+ * В случае выбора метода верхней релаксации последним аргументом ожидается параметр омега. Если вместо него передано
+ * auto или число не больше 0, омега подбирается автоматически по оценке спектрального радиуса
+ *
+ * Пакетный режим: --batch <метод> <формат вывода> [файл] [омега]. Метод -- 1 (Гаусс с выбором главного элемента)
+ * или 2 (верхняя релаксация), формат вывода -- как второй аргумент обычного режима. Системы, каждая из которых
+ * задаётся числом n, матрицей A и столбцом f, считываются из файла или, если он не задан или равен "-",
+ * со стандартного потока ввода. Решения выводятся в порядке ввода. Системы размера от 2 до 16 методом Гаусса
+ * решаются пакетами одного размера векторными ядрами (small.h)
+ *
+ * Преобразование форматов: --to-binary <n> [вход] [выход] переводит систему в текстовом формате ручного ввода
+ * в двоичный, --to-text <вход> [выход] -- двоичный файл в текстовый. Пропущенные или равные "-" файлы заменяются
+ * стандартными потоками
+ *
+ * Решение вне оперативной памяти: --tiled <формат вывода> <файл> <n> <m> [размер плитки]. Матрица, заданная
+ * функцией, записывается по плиткам в файл и раскладывается в нём, в памяти находятся только несколько панелей.
+ * После решения файл содержит множители разложения
+ *
+ * Режим сервера: --server [сокет]. Запросы в двоичном формате (см. server.h) принимаются через Unix-сокет или,
+ * если он не задан или равен "-", читаются со стандартного потока ввода, а ответы пишутся в стандартный поток
+ * вывода. Число потоков, решающих запросы, задаётся переменной окружения LE_SOLVER_THREADS
  */
+static int batch_main(int argc, char *argv[]);
+
+static int convert_main(int argc, char *argv[], _Bool to_binary);
+
+static int operator_main(int argc, char *argv[]);
+
+static int tiled_main(int argc, char *argv[]);
+
+static int server_main(int argc, char *argv[]);
+
 int main(int argc, char *argv[]) {
-    size_t n = strtoul(argv[4], NULL, 0);
-    mode = (int)strtoul(argv[2], NULL, 0) - 1;
+    if (argc >= 2 && strcmp(argv[1], "--server") == 0) {
+        return server_main(argc, argv);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--batch") == 0) {
+        return batch_main(argc, argv);
+    }
 
-    Matrix *a = new_matrix(n, n);
-    if (a == NULL) {
-        fprintf(stderr, "Ошибка выделения памяти\n");
-        return 1;
+    if (argc >= 3 && strcmp(argv[1], "--to-binary") == 0) {
+        return convert_main(argc, argv, 1);
     }
-    Matrix *f = new_matrix(n, 1);
-    if (f == NULL) {
-        fprintf(stderr, "Ошибка выделения памяти\n");
-        free_matrix(a);
-        return 1;
+    if (argc >= 3 && strcmp(argv[1], "--to-text") == 0) {
+        return convert_main(argc, argv, 0);
+    }
+    if (argc >= 6 && strcmp(argv[1], "--tiled") == 0) {
+        return tiled_main(argc, argv);
+    }
+
+    if (strtoul(argv[3], NULL, 0) == 4) {
+        return operator_main(argc, argv);
     }
 
+    int format = (int) strtoul(argv[2], NULL, 0) - 1;
+    FILE *info = format == FORMAT_BINARY ? stderr : stdout; // Подписи не смешиваются с двоичными записями
+
+    Matrix *a, *f;
+    MatrixFile *file = NULL;
+    if (strtoul(argv[3], NULL, 0) == 3) {
+        // Матрицы из двоичного файла используются без копирования
+        int status;
+        if ((file = open_matrix_file(argv[4], &status)) == NULL || file->count < 2) {
+            fprintf(stderr, "Некорректный двоичный файл %s\n", argv[4]);
+            close_matrix_file(file);
+            return 1;
+        }
+        a = matrix_file_get(file, 0, &status);
+        f = matrix_file_get(file, 1, &status);
+        if (a == NULL || f == NULL || a->row != a->col || f->row != a->row || f->col != 1) {
+            fprintf(stderr, "Некорректный двоичный файл %s\n", argv[4]);
+            free_matrix(a);
+            free_matrix(f);
+            close_matrix_file(file);
+            return 1;
+        }
+    } else {
+        size_t size = strtoul(argv[4], NULL, 0);
+        a = new_matrix(size, size);
+        if (a == NULL) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            return 1;
+        }
+        f = new_matrix(size, 1);
+        if (f == NULL) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            free_matrix(a);
+            return 1;
+        }
+    }
+    size_t n = a->row;
+
     if (strtoul(argv[3], NULL, 0) == 1) {
+        TextReader *reader = new_text_reader(stdin);
+        if (reader == NULL) {
+            fprintf(stderr, "Ошибка выделения памяти\n");
+            free_matrix(a);
+            free_matrix(f);
+            return 1;
+        }
         for (size_t i = 0; i < n; i++) {
             for (size_t j = 0; j < n; j++) {
-                data_t in;
-                scanf("%" PR_DATA_T, &in);
+                data_t in = 0;
+                read_value(reader, &in);
                 set_element(a, i, j, in);
             }
         }
         for (size_t i = 0; i < n; i++) {
-            data_t in;
-            scanf("%" PR_DATA_T, &in);
+            data_t in = 0;
+            read_value(reader, &in);
             set_element(f, i, 0, in);
         }
+        free_text_reader(reader);
     } else if (strtoul(argv[3], NULL, 0) == 2) {
-        size_t m = strtoul(argv[5], NULL, 0);
-        for (size_t i = 0; i < n; i++) {
-            for (size_t j = 0; j < n; j++) {
-                set_element(a, i, j, gen_function_a(n, m, i, j));
-            }
-        }
-        for (size_t i = 0; i < n; i++) {
-            set_element(f, i, 0, gen_function_f(n, m, i));
-        }
-    } else {
+        generate_system(GEN_FUNCTION, strtoul(argv[5], NULL, 0), 0, a, f);
+    } else if (file == NULL) {
         fprintf(stderr, "Некорректный режим задания матрицы\n");
         free_matrix(a);
         free_matrix(f);
         return 1;
     }
 
-    printf("Матрица системы :\n");
-    print_matrix(stdout, a);
-    printf("\nМатрица-столбец свободных членов :\n");
-    print_matrix(stdout, f);
+    fprintf(info, "Матрица системы :\n");
+    print_matrix(stdout, a, format);
+    fprintf(info, "\nМатрица-столбец свободных членов :\n");
+    print_matrix(stdout, f, format);
 
     if (strtoul(argv[1], NULL, 0) == 1) {
         int status;
-        data_t det = calc_determinant(a, 0, &status);
-        data_t det_pivot = calc_determinant(a, 1, &status);
-        data_t condition_number = calc_condition_number(a, &status);
-        Matrix *solution = gauss_solve(a, f, 0, &status);
-        Matrix *solution_pivot = gauss_solve(a, f, 1, &status);
-        Matrix *inverse = calc_inverse(a, &status);
-        if (status < 0) {
+        // Прямой ход выполняется по одному разу для каждого режима, остальное вычисляется по разложению
+        LUFactor *factor = lu_factor(a, 0, &status);
+        if (factor == NULL) {
+            fprintf(stderr, "Ошибка во время выполнения программы\n");
+            return 1;
+        }
+        LUFactor *factor_pivot = lu_factor(a, 1, &status);
+        if (factor_pivot == NULL) {
+            fprintf(stderr, "Ошибка во время выполнения программы\n");
+            free_lu_factor(factor);
+            return 1;
+        }
+        data_t det = lu_determinant(factor);
+        data_t det_pivot = lu_determinant(factor_pivot);
+        data_t condition_number = lu_condition_number(factor_pivot, a, &status);
+        Matrix *solution = lu_solve(factor, f, &status);
+        Matrix *solution_pivot = lu_solve(factor_pivot, f, &status);
+        Matrix *inverse = lu_inverse(factor_pivot, &status);
+        free_lu_factor(factor);
+        free_lu_factor(factor_pivot);
+        if (solution == NULL || solution_pivot == NULL || inverse == NULL) {
             fprintf(stderr, "Ошибка во время выполнения программы\n");
             return 1;
         }
 
-        printf("\nРешение системы найденное методом Гаусса :\n");
-        print_matrix(stdout, solution);
-        printf("\nРешение системы найденное методом Гаусса с выбором главного элемента :\n");
-        print_matrix(stdout, solution_pivot);
-        printf("\nОбратная матрица : \n");
-        print_matrix(stdout, inverse);
+        fprintf(info, "\nРешение системы найденное методом Гаусса :\n");
+        print_matrix(stdout, solution, format);
+        fprintf(info, "\nРешение системы найденное методом Гаусса с выбором главного элемента :\n");
+        print_matrix(stdout, solution_pivot, format);
+        MatrixStructure structure = detect_structure(a);
+        fprintf(info, "\nСтруктура матрицы : %s\n", structure_name(structure.type));
+        if (structure.type != STRUCTURE_DENSE) {
+            Matrix *solution_structured = structured_solve(a, f, &structure, &status);
+            if (solution_structured != NULL) {
+                fprintf(info, "\nРешение системы найденное с учётом структуры матрицы :\n");
+                print_matrix(stdout, solution_structured, format);
+            }
+            free_matrix(solution_structured);
+        } else if (is_symmetric(a)) {
+            CholeskyFactor *cholesky = cholesky_factor(a, &status);
+            Matrix *solution_cholesky = cholesky_solve(cholesky, f, &status);
+            if (solution_cholesky != NULL) {
+                fprintf(info, cholesky->positive ? "\nРешение системы найденное методом Холецкого :\n"
+                                                 : "\nРешение системы найденное разложением L * D * L^T :\n");
+                print_matrix(stdout, solution_cholesky, format);
+            }
+            free_matrix(solution_cholesky);
+            free_cholesky_factor(cholesky);
+        }
+        fprintf(info, "\nОбратная матрица : \n");
+        print_matrix(stdout, inverse, format);
 
-        printf("\nОпределитель вычисленный без выбора главного элемента : %" PR_DATA_T "\n", det);
-        printf("Оперделитель вычисленный с выбором главного элемента : %" PR_DATA_T "\n", det_pivot);
-        printf("Число обусловленности : %" PR_DATA_T "\n", condition_number);
+        fprintf(info, "\nОпределитель вычисленный без выбора главного элемента : %" PR_DATA_T "\n", det);
+        fprintf(info, "Оперделитель вычисленный с выбором главного элемента : %" PR_DATA_T "\n", det_pivot);
+        // Обратная матрица уже вычислена, поэтому точное значение стоит O(n^2), как и оценка
+        fprintf(info, "Число обусловленности : %" PR_DATA_T "\n", matrix_norm(a) * matrix_norm(inverse));
+        fprintf(info, "Оценка числа обусловленности : %" PR_DATA_T "\n", condition_number);
 
         free_matrix(solution_pivot);
         free_matrix(solution);
         free_matrix(inverse);
-    } else if (strtoul(argv[1], NULL, 0) == 2) {
+    } else if ((strtoul(argv[1], NULL, 0) >= 2 && strtoul(argv[1], NULL, 0) <= 4) || strtoul(argv[1], NULL, 0) == 6) {
         int status;
         size_t iter;
         data_t omega = strtod(argv[argc - 1], NULL);
 
-        Matrix *solution = relaxation(a, f, omega, 1e-10, &iter, &status);
+        Matrix *solution;
+        if (strtoul(argv[1], NULL, 0) == 2) {
+            solution = relaxation(a, f, omega, 1e-10, &iter, &status);
+        } else if (strtoul(argv[1], NULL, 0) == 3) {
+            solution = relaxation_multicolor(a, f, omega, 1e-10, &iter, &status);
+        } else if (strtoul(argv[1], NULL, 0) == 4) {
+            solution = relaxation_normal(a, f, omega, 1e-10, &iter, &status);
+        } else {
+            solution = relaxation_chebyshev(a, f, omega, 1e-10, &iter, &status);
+        }
         if (status < 0) {
             fprintf(stderr, "Ошибка во время выполнения программы\n");
             return 1;
         }
 
-        printf("\nРешение системы найденное методом верхней релаксации :\n");
-        print_matrix(stdout, solution);
-        printf("\nСовершено %ld итераций\n", (long) iter);
+        fprintf(info, "\nРешение системы найденное методом верхней релаксации :\n");
+        print_matrix(stdout, solution, format);
+        fprintf(info, "\nСовершено %ld итераций\n", (long) iter);
+        free_matrix(solution);
+    } else if (strtoul(argv[1], NULL, 0) == 7) {
+        int status;
+        size_t refinements;
+        Matrix *solution = gauss_solve_mixed(a, f, &refinements, &status);
+        if (solution == NULL) {
+            fprintf(stderr, "Ошибка во время выполнения программы\n");
+            return 1;
+        }
+
+        fprintf(info, "\nРешение системы найденное методом Гаусса в смешанной точности :\n");
+        print_matrix(stdout, solution, format);
+        if (refinements > 0) {
+            fprintf(info, "\nСовершено %ld шагов уточнения\n", (long) refinements);
+        } else {
+            fprintf(info, "\nРешение найдено в двойной точности\n");
+        }
+        free_matrix(solution);
+    } else if (strtoul(argv[1], NULL, 0) == 5) {
+        int status;
+        size_t iter;
+        SparseMatrix *sparse = sparse_from_dense(a, &status);
+        if (sparse == NULL) {
+            fprintf(stderr, "Ошибка во время выполнения программы\n");
+            return 1;
+        }
+        Preconditioner *preconditioner = ilu0_preconditioner(sparse, &status); // Без предобусловливателя, если
+        // разложение ILU(0) не существует
+        Matrix *solution = gmres_solve(sparse_matvec, sparse, f, preconditioner, 30, 1e-10, 10 * n + 100, &iter,
+                                       &status);
+        free_preconditioner(preconditioner);
+        free_sparse_matrix(sparse);
+        if (solution == NULL) {
+            fprintf(stderr, "Ошибка во время выполнения программы\n");
+            return 1;
+        }
+        if (status == NOT_CONVERGED) {
+            fprintf(stderr, "Метод GMRES не сошёлся с заданной точностью\n");
+        }
+
+        fprintf(info, "\nРешение системы найденное методом GMRES :\n");
+        print_matrix(stdout, solution, format);
+        fprintf(info, "\nСовершено %ld итераций\n", (long) iter);
         free_matrix(solution);
     }
 
     free_matrix(a);
     free_matrix(f);
+    close_matrix_file(file);
+    PROFILE_FINISH();
     return 0;
 }
 
-data_t gen_function_a(size_t n, size_t m, size_t i, size_t j)
+static int batch_main(int argc, char *argv[])
 {
-    return i == j ? n + ((data_t) m) * m + ((data_t) j) / m + ((data_t) i) / n
-            : ((data_t) i + j) / (((data_t)m) + n);
+    int method = (int) strtoul(argv[2], NULL, 0);
+    int format = (int) strtoul(argv[3], NULL, 0) - 1;
+    FILE *in = stdin;
+    if (argc >= 5 && strcmp(argv[4], "-") != 0 && (in = fopen(argv[4], "r")) == NULL) {
+        fprintf(stderr, "Не удалось открыть файл %s\n", argv[4]);
+        return 1;
+    }
+    data_t omega = argc >= 6 ? strtod(argv[5], NULL) : 1.0;
+
+    size_t solved;
+    int status = batch_solve(in, stdout, method, format, omega, &solved);
+    if (in != stdin) {
+        fclose(in);
+    }
+    PROFILE_FINISH();
+    if (status != OK) {
+        fprintf(stderr, "Ошибка во время выполнения программы\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int operator_main(int argc, char *argv[])
+{
+    int format = (int) strtoul(argv[2], NULL, 0) - 1;
+    FILE *info = format == FORMAT_BINARY ? stderr : stdout;
+    unsigned long method = strtoul(argv[1], NULL, 0);
+    if (method != 2 && method != 5) {
+        fprintf(stderr, "Метод недоступен для матрицы, заданной без хранения\n");
+        return 1;
+    }
+
+    int status;
+    size_t n = strtoul(argv[4], NULL, 0), m = strtoul(argv[5], NULL, 0);
+    Operator *a = new_function_operator(n, m, &status);
+    Matrix *f = new_matrix(n, 1);
+    if (a == NULL || f == NULL) {
+        fprintf(stderr, "Ошибка выделения памяти\n");
+        free_operator(a);
+        free_matrix(f);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        set_element(f, i, 0, gen_function_f(n, m, i));
+    }
+
+    fprintf(info, "Матрица системы задана функцией, размер %ld\n", (long) n);
+    fprintf(info, "\nМатрица-столбец свободных членов :\n");
+    print_matrix(stdout, f, format);
+
+    size_t iter;
+    Matrix *solution;
+    if (method == 2) {
+        data_t omega = argc >= 7 ? strtod(argv[6], NULL) : RELAXATION_AUTO_OMEGA;
+        solution = operator_relaxation(a, f, omega, 1e-10, 10 * n + 100, &iter, &status);
+    } else {
+        Preconditioner *preconditioner = operator_jacobi_preconditioner(a, &status);
+        solution = gmres_solve(operator_matvec, a, f, preconditioner, 30, 1e-10, 10 * n + 100, &iter, &status);
+        free_preconditioner(preconditioner);
+    }
+    free_operator(a);
+    if (solution == NULL) {
+        fprintf(stderr, "Ошибка во время выполнения программы\n");
+        free_matrix(f);
+        return 1;
+    }
+    if (status == NOT_CONVERGED) {
+        fprintf(stderr, "Метод не сошёлся с заданной точностью\n");
+    }
+
+    fprintf(info, method == 2 ? "\nРешение системы найденное методом верхней релаксации :\n"
+                              : "\nРешение системы найденное методом GMRES :\n");
+    print_matrix(stdout, solution, format);
+    fprintf(info, "\nСовершено %ld итераций\n", (long) iter);
+    free_matrix(solution);
+    free_matrix(f);
+    PROFILE_FINISH();
+    return 0;
 }
 
-data_t gen_function_f(size_t n, size_t m, size_t i)
+static int tiled_main(int argc, char *argv[])
 {
-    return ((data_t) m) * i + n;
-}
\ No newline at end of file
+    int format = (int) strtoul(argv[2], NULL, 0) - 1;
+    FILE *info = format == FORMAT_BINARY ? stderr : stdout;
+    size_t n = strtoul(argv[4], NULL, 0), m = strtoul(argv[5], NULL, 0);
+    size_t tile = argc >= 7 ? strtoul(argv[6], NULL, 0) : 256;
+
+    int status;
+    Operator *a = new_function_operator(n, m, &status);
+    TileStore *store = new_tile_store(argv[3], n, tile, &status);
+    Matrix *f = new_matrix(n, 1);
+    if (a == NULL || store == NULL || f == NULL) {
+        fprintf(stderr, "Не удалось создать файл %s\n", argv[3]);
+        free_operator(a);
+        free_tile_store(store);
+        free_matrix(f);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        set_element(f, i, 0, gen_function_f(n, m, i));
+    }
+
+    TiledLU *factor = NULL;
+    Matrix *solution = NULL;
+    if (tile_store_fill(store, a) == OK && (factor = tiled_lu_factor(store, &status)) != NULL) {
+        solution = tiled_lu_solve(factor, f, &status);
+    }
+    free_tiled_lu(factor);
+    free_tile_store(store);
+    free_operator(a);
+    free_matrix(f);
+    if (solution == NULL) {
+        fprintf(stderr, "Ошибка во время выполнения программы\n");
+        return 1;
+    }
+
+    fprintf(info, "Решение системы найденное методом Гаусса вне оперативной памяти :\n");
+    print_matrix(stdout, solution, format);
+    free_matrix(solution);
+    PROFILE_FINISH();
+    return 0;
+}
+
+static int convert_main(int argc, char *argv[], _Bool to_binary)
+{
+    int in_arg = to_binary ? 3 : 2;
+    int out_arg = in_arg + 1;
+    FILE *in = stdin, *out = stdout;
+    if (to_binary && argc > in_arg && strcmp(argv[in_arg], "-") != 0 && (in = fopen(argv[in_arg], "r")) == NULL) {
+        fprintf(stderr, "Не удалось открыть файл %s\n", argv[in_arg]);
+        return 1;
+    }
+    if (argc > out_arg && strcmp(argv[out_arg], "-") != 0 &&
+        (out = fopen(argv[out_arg], to_binary ? "wb" : "w")) == NULL) {
+        fprintf(stderr, "Не удалось открыть файл %s\n", argv[out_arg]);
+        if (in != stdin) {
+            fclose(in);
+        }
+        return 1;
+    }
+
+    int status;
+    if (to_binary) {
+        status = convert_text_to_binary(in, out, strtoul(argv[2], NULL, 0));
+    } else {
+        // Двоичный файл отображается в память, поэтому стандартный поток ввода не поддерживается
+        status = convert_binary_to_text(argv[in_arg], out);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (status != OK) {
+        fprintf(stderr, "Ошибка во время выполнения программы\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int server_main(int argc, char *argv[])
+{
+    int status = argc >= 3 && strcmp(argv[2], "-") != 0 ? serve_socket(argv[2]) : serve_stream(0, 1);
+    PROFILE_FINISH();
+    if (status != OK) {
+        fprintf(stderr, "Ошибка во время выполнения программы\n");
+        return 1;
+    }
+    return 0;
+}
@@ -1,100 +1,305 @@
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "matrix.h"
+#include "profile.h"
+#include "threads.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MATRIX_MUL_X86
+#endif
+
+#define MATRIX_HEADER_SIZE MATRIX_ALIGN_UP(sizeof(Matrix))
+
+static size_t matrix_stride(size_t col)
+{
+    // Строки из нескольких строк кэша дополняются так, чтобы каждая начиналась с границы строки кэша. Узкие
+    // матрицы и векторы-столбцы не дополняются, иначе их размер вырос бы в разы
+    size_t line = MATRIX_ALIGNMENT / sizeof(data_t);
+    return col < line ? col : (col + line - 1) / line * line;
+}
+
+size_t matrix_storage_size(size_t row, size_t col) {
+    return MATRIX_HEADER_SIZE + MATRIX_ALIGN_UP(sizeof(data_t) * row * matrix_stride(col));
+}
+
+static void init_matrix(Matrix *matrix, size_t row, size_t col, int storage)
+{
+    matrix->row = row;
+    matrix->col = col;
+    matrix->stride = matrix_stride(col);
+    matrix->storage = storage;
+    matrix->values = (data_t *) ((unsigned char *) matrix + MATRIX_HEADER_SIZE);
+}
 
 Matrix *new_matrix(size_t row, size_t col) {
-    Matrix *matrix = calloc(1, sizeof(*matrix) + sizeof(data_t) * row * col);
+    // Заголовок и значения выделяются одним блоком, значения начинаются с границы строки кэша
+    size_t size = matrix_storage_size(row, col);
+    Matrix *matrix = aligned_alloc(MATRIX_ALIGNMENT, size);
     if (matrix == NULL) {
         return NULL;
     }
-    matrix->col = col;
-    matrix->row = row;
+    memset(matrix, 0, size);
+    init_matrix(matrix, row, col, STORAGE_HEAP);
+    PROFILE_COUNT(0, size, 0);
     return matrix;
 }
 
 void free_matrix(Matrix *matrix) {
-    free(matrix);
+    if (matrix != NULL && matrix->storage != STORAGE_WORKSPACE) { // Память в Workspace освобождается вместе с ним
+        free(matrix);
+    }
+}
+
+// Шаг строк источника может отличаться от шага копии (например, у отображённых из файла матриц строки не
+// дополняются), поэтому одним блоком копируются только матрицы с одинаковым шагом
+static void copy_values(Matrix *copy, Matrix *matrix)
+{
+    if (copy->stride == matrix->stride) {
+        memcpy(copy->values, matrix->values, matrix->stride * matrix->row * sizeof(*(copy->values)));
+        return;
+    }
+    for (size_t i = 0; i < matrix->row; i++) {
+        memcpy(copy->values + i * copy->stride, matrix->values + i * matrix->stride,
+               matrix->col * sizeof(*(copy->values)));
+    }
 }
 
 Matrix *copy_matrix(Matrix *matrix) {
+    PROFILE_BEGIN("copy_matrix");
     Matrix *copy = new_matrix(matrix->row, matrix->col);
     if (copy == NULL) {
         return NULL;
     }
-    *copy = *matrix;
-    memcpy(copy->values, matrix->values, matrix->col * matrix->row * sizeof(*(copy->values)));
+    copy_values(copy, matrix);
     return copy;
 }
 
 data_t get_element(Matrix *matrix, size_t row, size_t col) {
-    return matrix->values[col + matrix->col * row];
+    return matrix->values[col + matrix->stride * row];
 }
 
 void set_element(Matrix *matrix, size_t row, size_t col, data_t val) {
-    matrix->values[col + matrix->col * row] = val;
+    matrix->values[col + matrix->stride * row] = val;
 }
 
 void mul_sub_row(Matrix *matrix, size_t s, size_t d, data_t c) {
     for (size_t i = 0; i < matrix->col; i++) {
-        matrix->values[i + d * matrix->col] += c * matrix->values[i + s * matrix->col];
+        matrix->values[i + d * matrix->stride] += c * matrix->values[i + s * matrix->stride];
+    }
+}
+
+void swap_row(Matrix *matrix, size_t s, size_t d) {
+    for (size_t i = 0; i < matrix->col; i++) {
+        data_t tmp = matrix->values[i + d * matrix->stride];
+        matrix->values[i + d * matrix->stride] = matrix->values[i + s * matrix->stride];
+        matrix->values[i + s * matrix->stride] = tmp;
+    }
+}
+
+void mul_row(Matrix *matrix, size_t row, data_t c) {
+    for (size_t i = 0; i < matrix->col; i++) {
+        matrix->values[i + row * matrix->stride] *= c;
+    }
+}
+
+// Размеры блоков, на которые разбивается произведение: полоса из MUL_BLOCK_K строк матрицы b и MUL_BLOCK_J
+// столбцов должна помещаться в кэш, а блок результата MUL_KERNEL_ROWS на ширину ядра -- в регистры
+#define MUL_BLOCK_K 128
+#define MUL_BLOCK_J 256
+#define MUL_KERNEL_ROWS 4
+// Число строк результата, вычисляемых одним потоком за раз
+#define MUL_PANEL_ROWS (16 * MUL_KERNEL_ROWS)
+
+// Ядро вычисляет c[0..MUL_KERNEL_ROWS)[0..width) += a[0..MUL_KERNEL_ROWS)[0..k_count) * b[0..k_count)[0..width)
+typedef void (*mul_kernel_t)(size_t k_count, const data_t *a, size_t lda, const data_t *b, size_t ldb,
+                             data_t *c, size_t ldc);
+
+#ifdef MATRIX_MUL_X86
+_Static_assert(sizeof(data_t) == sizeof(double), "SIMD kernels expect data_t to be double");
+
+__attribute__((target("avx2,fma")))
+static void mul_kernel_avx2(size_t k_count, const data_t *a, size_t lda, const data_t *b, size_t ldb,
+                            data_t *c, size_t ldc)
+{
+    // Блок результата 4 x 8 целиком хранится в восьми регистрах
+    __m256d c00 = _mm256_loadu_pd(c), c01 = _mm256_loadu_pd(c + 4);
+    __m256d c10 = _mm256_loadu_pd(c + ldc), c11 = _mm256_loadu_pd(c + ldc + 4);
+    __m256d c20 = _mm256_loadu_pd(c + 2 * ldc), c21 = _mm256_loadu_pd(c + 2 * ldc + 4);
+    __m256d c30 = _mm256_loadu_pd(c + 3 * ldc), c31 = _mm256_loadu_pd(c + 3 * ldc + 4);
+    for (size_t k = 0; k < k_count; k++) {
+        __m256d b0 = _mm256_loadu_pd(b + k * ldb), b1 = _mm256_loadu_pd(b + k * ldb + 4);
+        __m256d a0 = _mm256_broadcast_sd(a + k);
+        c00 = _mm256_fmadd_pd(a0, b0, c00);
+        c01 = _mm256_fmadd_pd(a0, b1, c01);
+        __m256d a1 = _mm256_broadcast_sd(a + lda + k);
+        c10 = _mm256_fmadd_pd(a1, b0, c10);
+        c11 = _mm256_fmadd_pd(a1, b1, c11);
+        __m256d a2 = _mm256_broadcast_sd(a + 2 * lda + k);
+        c20 = _mm256_fmadd_pd(a2, b0, c20);
+        c21 = _mm256_fmadd_pd(a2, b1, c21);
+        __m256d a3 = _mm256_broadcast_sd(a + 3 * lda + k);
+        c30 = _mm256_fmadd_pd(a3, b0, c30);
+        c31 = _mm256_fmadd_pd(a3, b1, c31);
+    }
+    _mm256_storeu_pd(c, c00);
+    _mm256_storeu_pd(c + 4, c01);
+    _mm256_storeu_pd(c + ldc, c10);
+    _mm256_storeu_pd(c + ldc + 4, c11);
+    _mm256_storeu_pd(c + 2 * ldc, c20);
+    _mm256_storeu_pd(c + 2 * ldc + 4, c21);
+    _mm256_storeu_pd(c + 3 * ldc, c30);
+    _mm256_storeu_pd(c + 3 * ldc + 4, c31);
+}
+
+__attribute__((target("avx512f")))
+static void mul_kernel_avx512(size_t k_count, const data_t *a, size_t lda, const data_t *b, size_t ldb,
+                              data_t *c, size_t ldc)
+{
+    // Блок результата 4 x 16 целиком хранится в восьми регистрах
+    __m512d c00 = _mm512_loadu_pd(c), c01 = _mm512_loadu_pd(c + 8);
+    __m512d c10 = _mm512_loadu_pd(c + ldc), c11 = _mm512_loadu_pd(c + ldc + 8);
+    __m512d c20 = _mm512_loadu_pd(c + 2 * ldc), c21 = _mm512_loadu_pd(c + 2 * ldc + 8);
+    __m512d c30 = _mm512_loadu_pd(c + 3 * ldc), c31 = _mm512_loadu_pd(c + 3 * ldc + 8);
+    for (size_t k = 0; k < k_count; k++) {
+        __m512d b0 = _mm512_loadu_pd(b + k * ldb), b1 = _mm512_loadu_pd(b + k * ldb + 8);
+        __m512d a0 = _mm512_set1_pd(a[k]);
+        c00 = _mm512_fmadd_pd(a0, b0, c00);
+        c01 = _mm512_fmadd_pd(a0, b1, c01);
+        __m512d a1 = _mm512_set1_pd(a[lda + k]);
+        c10 = _mm512_fmadd_pd(a1, b0, c10);
+        c11 = _mm512_fmadd_pd(a1, b1, c11);
+        __m512d a2 = _mm512_set1_pd(a[2 * lda + k]);
+        c20 = _mm512_fmadd_pd(a2, b0, c20);
+        c21 = _mm512_fmadd_pd(a2, b1, c21);
+        __m512d a3 = _mm512_set1_pd(a[3 * lda + k]);
+        c30 = _mm512_fmadd_pd(a3, b0, c30);
+        c31 = _mm512_fmadd_pd(a3, b1, c31);
     }
+    _mm512_storeu_pd(c, c00);
+    _mm512_storeu_pd(c + 8, c01);
+    _mm512_storeu_pd(c + ldc, c10);
+    _mm512_storeu_pd(c + ldc + 8, c11);
+    _mm512_storeu_pd(c + 2 * ldc, c20);
+    _mm512_storeu_pd(c + 2 * ldc + 8, c21);
+    _mm512_storeu_pd(c + 3 * ldc, c30);
+    _mm512_storeu_pd(c + 3 * ldc + 8, c31);
 }
+#endif
 
-int mode = 0;
+static mul_kernel_t mul_kernel = NULL;
+static size_t mul_kernel_width = 0;
+// Умножение вызывается из потоков пакетного режима и сервера, поэтому ядро выбирается под pthread_once: после
+// возврата из него mul_kernel и mul_kernel_width видны всем потокам
+static pthread_once_t mul_kernel_once = PTHREAD_ONCE_INIT;
 
-void print_matrix(FILE *file, Matrix *matrix) {
-    if (mode == 0) {
-        for (size_t i = 0; i < matrix->row; i++) {
-            for (size_t j = 0; j < matrix->col; j++) {
-                fprintf(file, "%10.5" PR_DATA_T " ", matrix->values[j + matrix->col * i]);
+static void select_mul_kernel(void)
+{
+    // Ядро выбирается один раз по возможностям процессора, на котором запущена программа
+#ifdef MATRIX_MUL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        mul_kernel = mul_kernel_avx512;
+        mul_kernel_width = 16;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        mul_kernel = mul_kernel_avx2;
+        mul_kernel_width = 8;
+    }
+#endif
+}
+
+static void mul_naive(Matrix *a, Matrix *b, Matrix *res)
+{
+    for (size_t i = 0; i < a->row; i++) {
+        for (size_t j = 0; j < b->col; j++) {
+            for (size_t k = 0; k < a->col; k++) {
+                res->values[j + res->stride * i] += a->values[k + a->stride * i] * b->values[j + b->stride * k];
             }
-            fputs("\n", file);
         }
-    } else {
-        fputs("{", file);
-        for (size_t i = 0; i < matrix->row; i++) {
-            fputs("{", file);
-            for (size_t j = 0; j < matrix->col; j++) {
-                fprintf(file, "%" PR_DATA_T "%s", matrix->values[j + matrix->col * i],
-                        j != matrix->col - 1 ? ", " : "");
+    }
+}
+
+// Скалярная обработка краёв блока, не покрытых ядром. Порядок циклов i-k-j обходит строки b последовательно
+static void mul_edge(Matrix *a, Matrix *b, Matrix *res, size_t i_begin, size_t i_end, size_t j_begin, size_t j_end,
+                     size_t k_begin, size_t k_end)
+{
+    for (size_t i = i_begin; i < i_end; i++) {
+        for (size_t k = k_begin; k < k_end; k++) {
+            data_t a_ik = a->values[k + a->stride * i];
+            for (size_t j = j_begin; j < j_end; j++) {
+                res->values[j + res->stride * i] += a_ik * b->values[j + b->stride * k];
             }
-            fputs(i != matrix->row - 1 ? "}," : "}", file);
         }
-        fputs("}\n", file);
     }
 }
 
-void swap_row(Matrix *matrix, size_t s, size_t d) {
-    for (size_t i = 0; i < matrix->col; i++) {
-        data_t tmp = matrix->values[i + d * matrix->col];
-        matrix->values[i + d * matrix->col] = matrix->values[i + s * matrix->col];
-        matrix->values[i + s * matrix->col] = tmp;
+// Строки результата from..to. Если triangular, то a -- верхняя треугольная, b -- нижняя треугольная матрица:
+// для строки i слагаемые с k < i равны нулю, а в полосе k < k_end ненулевые только столбцы j < k_end
+static void mul_blocked(Matrix *a, Matrix *b, Matrix *res, size_t from, size_t to, _Bool triangular)
+{
+    for (size_t kk = triangular ? from : 0; kk < a->col; kk += MUL_BLOCK_K) {
+        size_t k_end = kk + MUL_BLOCK_K < a->col ? kk + MUL_BLOCK_K : a->col;
+        size_t cols = triangular && k_end < b->col ? k_end : b->col;
+        for (size_t jj = 0; jj < cols; jj += MUL_BLOCK_J) {
+            size_t j_end = jj + MUL_BLOCK_J < cols ? jj + MUL_BLOCK_J : cols;
+            size_t j_full = jj + (j_end - jj) / mul_kernel_width * mul_kernel_width; // Граница полных блоков ядра
+            for (size_t i = from; i < to; i += MUL_KERNEL_ROWS) {
+                if (i + MUL_KERNEL_ROWS > to) { // Оставшиеся строки не заполняют ядро целиком
+                    mul_edge(a, b, res, i, to, jj, j_end, kk, k_end);
+                    continue;
+                }
+                for (size_t j = jj; j < j_full; j += mul_kernel_width) {
+                    mul_kernel(k_end - kk, &a->values[kk + a->stride * i], a->stride, &b->values[j + b->stride * kk],
+                               b->stride, &res->values[j + res->stride * i], res->stride);
+                }
+                mul_edge(a, b, res, i, i + MUL_KERNEL_ROWS, j_full, j_end, kk, k_end);
+            }
+        }
     }
 }
 
-void mul_row(Matrix *matrix, size_t row, data_t c) {
-    for (size_t i = 0; i < matrix->col; i++) {
-        matrix->values[i + row * matrix->col] *= c;
+static void mul_panels(Matrix *a, Matrix *b, Matrix *res, _Bool triangular)
+{
+    pthread_once(&mul_kernel_once, select_mul_kernel);
+    if (mul_kernel == NULL) {
+        mul_naive(a, b, res); // Переносимый вариант для процессоров без поддерживаемых векторных расширений
+        return;
+    }
+    // Полосы строк результата независимы и распределяются по потокам
+    size_t panels = (a->row + MUL_PANEL_ROWS - 1) / MUL_PANEL_ROWS;
+    PARALLEL_FOR(num_threads(get_thread_count()) if(a->row * a->col * b->col > PARALLEL_THRESHOLD) schedule(static, 1))
+    for (size_t p = 0; p < panels; p++) {
+        size_t to = (p + 1) * MUL_PANEL_ROWS < a->row ? (p + 1) * MUL_PANEL_ROWS : a->row;
+        mul_blocked(a, b, res, p * MUL_PANEL_ROWS, to, triangular);
     }
 }
 
 Matrix *matrix_mul(Matrix *a, Matrix *b) {
+    PROFILE_BEGIN("matrix_mul");
+    PROFILE_COUNT(2 * a->row * a->col * b->col, 0, 0);
     Matrix *res = new_matrix(a->row, b->col);
     if (res == NULL) {
         return NULL;
     }
-    for (size_t i = 0; i < a->row; i++) {
-        for (size_t j = 0; j < b->col; j++) {
-            for (size_t k = 0; k < a->col; k++) {
-                res->values[j + res->col * i] += a->values[k + a->col * i] * b->values[j + b->col * k];
-            }
-        }
+    mul_panels(a, b, res, 0);
+    return res;
+}
+
+Matrix *matrix_mul_triangular(Matrix *upper, Matrix *lower, Workspace *workspace) {
+    PROFILE_BEGIN("matrix_mul_triangular");
+    PROFILE_COUNT(2 * upper->row * upper->row * upper->row / 3, 0, 0);
+    Matrix *res = workspace_matrix(workspace, upper->row, lower->col);
+    if (res == NULL) {
+        return NULL;
     }
+    mul_panels(upper, lower, res, 1);
     return res;
 }
 
 Matrix *transpose(Matrix *matrix) {
+    PROFILE_BEGIN("transpose");
     Matrix *res = new_matrix(matrix->col, matrix->row);
     if (res == NULL) {
         return NULL;
@@ -102,9 +307,85 @@ Matrix *transpose(Matrix *matrix) {
 
     for (size_t i = 0; i < res->row; i++) {
         for (size_t j = 0; j < res->col; j++) {
-            res->values[j + res->col * i] = matrix->values[i + matrix->col * j];
+            res->values[j + res->stride * i] = matrix->values[i + matrix->stride * j];
         }
     }
     return res;
 }
 
+
+Workspace *new_workspace(size_t size) {
+    Workspace *workspace = malloc(sizeof(*workspace));
+    if (workspace == NULL) {
+        return NULL;
+    }
+    workspace->size = MATRIX_ALIGN_UP(size);
+    workspace->used = 0;
+    workspace->base = aligned_alloc(MATRIX_ALIGNMENT, workspace->size != 0 ? workspace->size : MATRIX_ALIGNMENT);
+    if (workspace->base == NULL) {
+        free(workspace);
+        return NULL;
+    }
+    memset(workspace->base, 0, workspace->size); // Страницы затрагиваются один раз при создании
+    PROFILE_COUNT(0, workspace->size, 0);
+    return workspace;
+}
+
+void free_workspace(Workspace *workspace) {
+    if (workspace == NULL) {
+        return;
+    }
+    free(workspace->base);
+    free(workspace);
+}
+
+void reset_workspace(Workspace *workspace) {
+    workspace->used = 0;
+}
+
+void *workspace_alloc(Workspace *workspace, size_t size) {
+    // Без Workspace память выделяется в куче и освобождается через workspace_free
+    if (workspace == NULL) {
+        PROFILE_COUNT(0, MATRIX_ALIGN_UP(size != 0 ? size : 1), 0);
+        return aligned_alloc(MATRIX_ALIGNMENT, MATRIX_ALIGN_UP(size != 0 ? size : 1));
+    }
+    size = MATRIX_ALIGN_UP(size);
+    if (size > workspace->size - workspace->used) {
+        return NULL;
+    }
+    void *ptr = workspace->base + workspace->used;
+    workspace->used += size;
+    return ptr;
+}
+
+void workspace_free(Workspace *workspace, void *ptr) {
+    if (workspace == NULL) {
+        free(ptr);
+    }
+}
+
+Matrix *workspace_matrix(Workspace *workspace, size_t row, size_t col) {
+    if (workspace == NULL) {
+        return new_matrix(row, col);
+    }
+    size_t size = matrix_storage_size(row, col);
+    Matrix *matrix = workspace_alloc(workspace, size);
+    if (matrix == NULL) {
+        return NULL;
+    }
+    memset(matrix, 0, size); // Память могла использоваться предыдущими вычислениями
+    init_matrix(matrix, row, col, STORAGE_WORKSPACE);
+    return matrix;
+}
+
+Matrix *workspace_copy(Workspace *workspace, Matrix *matrix) {
+    if (workspace == NULL) {
+        return copy_matrix(matrix);
+    }
+    Matrix *copy = workspace_matrix(workspace, matrix->row, matrix->col);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy_values(copy, matrix);
+    return copy;
+}
@@ -7,14 +7,36 @@
 typedef double data_t;
 #define PR_DATA_T "lf"
 
+// Выравнивание хранимых значений матрицы -- размер строки кэша
+#define MATRIX_ALIGNMENT 64
+#define MATRIX_ALIGN_UP(size) (((size) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT)
+
+enum {
+    STORAGE_HEAP = 0,
+    STORAGE_WORKSPACE,
+    STORAGE_MAPPED // Значения находятся в отображённом в память файле, выделен только заголовок
+};
+
 typedef struct {
     size_t row;
     size_t col;
-    data_t values[];
+    size_t stride; // Расстояние между началами соседних строк, строки дополняются до целого числа строк кэша
+    int storage;
+    data_t *values;
 } Matrix;
 
+// Область памяти для временных данных вычислений. Память выделяется последовательно и освобождается целиком
+// вызовом reset_workspace, поэтому повторные вычисления с одной областью не обращаются к куче
+typedef struct {
+    unsigned char *base;
+    size_t size;
+    size_t used;
+} Workspace;
+
 Matrix *new_matrix(size_t row, size_t col);
 
+size_t matrix_storage_size(size_t row, size_t col);
+
 void free_matrix(Matrix *matrix);
 
 Matrix *copy_matrix(Matrix *matrix);
@@ -31,8 +53,24 @@ void swap_row(Matrix *matrix, size_t s, size_t d);
 
 Matrix *matrix_mul(Matrix *a, Matrix *b);
 
+// Произведение верхней треугольной матрицы на нижнюю треугольную, нулевые блоки сомножителей пропускаются.
+// Результат размещается в workspace или в куче, если он равен NULL
+Matrix *matrix_mul_triangular(Matrix *upper, Matrix *lower, Workspace *workspace);
+
 Matrix *transpose(Matrix *matrix);
 
-void print_matrix(FILE *file, Matrix *matrix);
+Workspace *new_workspace(size_t size);
+
+void free_workspace(Workspace *workspace);
+
+void reset_workspace(Workspace *workspace);
+
+void *workspace_alloc(Workspace *workspace, size_t size);
+
+void workspace_free(Workspace *workspace, void *ptr);
+
+Matrix *workspace_matrix(Workspace *workspace, size_t row, size_t col);
+
+Matrix *workspace_copy(Workspace *workspace, Matrix *matrix);
 
 #endif //LE_SOLVER_MATRIX_H
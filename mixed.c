@@ -0,0 +1,201 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "mixed.h"
+#include "error.h"
+#include "threads.h"
+#include "profile.h"
+
+#define KERNEL_TYPE float
+#define KERNEL_ABS fabsf
+#define KERNEL_SUFFIX _float
+#include "lu_kernel.h"
+
+#define KERNEL_TYPE double
+#define KERNEL_ABS fabs
+#define KERNEL_SUFFIX _double
+#include "lu_kernel.h"
+
+#define MIXED_MAX_REFINEMENTS 30
+
+// Шаг строк выбирается так, чтобы каждая строка начиналась с границы строки кэша
+static void *new_kernel_matrix(size_t n, size_t element_size, size_t *lda)
+{
+    size_t line = MATRIX_ALIGNMENT / element_size;
+    *lda = (n + line - 1) / line * line;
+    return aligned_alloc(MATRIX_ALIGNMENT, MATRIX_ALIGN_UP(n * *lda * element_size + 1));
+}
+
+// Возвращает 0, если элемент не представим в одинарной точности
+static _Bool to_single(Matrix *a, float *single, size_t lda)
+{
+    for (size_t i = 0; i < a->row; i++) {
+        for (size_t j = 0; j < a->col; j++) {
+            data_t value = get_element(a, i, j);
+            if (!(fabs(value) <= FLT_MAX)) {
+                return 0;
+            }
+            single[i * lda + j] = (float) value;
+        }
+    }
+    return 1;
+}
+
+// r = f_column - A * x, возвращает ||r||_inf
+static data_t residual_norm(Matrix *a, Matrix *f, size_t column, const data_t *x, data_t *r)
+{
+    PROFILE_BEGIN("mixed_residual");
+    size_t n = a->row;
+    data_t norm = 0.0;
+    PARALLEL_FOR(num_threads(get_thread_count()) if(n * n > PARALLEL_THRESHOLD) reduction(max:norm) schedule(static))
+    for (size_t i = 0; i < n; i++) {
+        data_t sum = get_element(f, i, column);
+        for (size_t j = 0; j < n; j++) {
+            sum -= get_element(a, i, j) * x[j];
+        }
+        r[i] = sum;
+        norm = fmax(norm, fabs(sum));
+    }
+    PROFILE_COUNT(2 * n * n, 0, 0);
+    return norm;
+}
+
+// Уточнение одного столбца решения: x_(k+1) = x_k + (L * U)^-1 * (f - A * x_k), где разложение и решение систем с
+// ним выполняются в одинарной точности, а невязка и x -- в double. Критерий остановки тот же, что и в LAPACK
+// (dsgesv): ||r|| <= ||x|| * ||A|| * eps * sqrt(n). Возвращает 0, если он не достигнут
+static _Bool refine_column(Matrix *a, Matrix *f, size_t column, const float *lu, size_t lda, const size_t *pivots,
+                           data_t a_norm, data_t *x, data_t *r, float *correction, size_t *refinements)
+{
+    size_t n = a->row;
+    data_t threshold = a_norm * DBL_EPSILON * sqrt((data_t) n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = 0.0;
+        r[i] = get_element(f, i, column);
+    }
+    for (size_t step = 0; step <= MIXED_MAX_REFINEMENTS; step++) {
+        for (size_t i = 0; i < n; i++) {
+            correction[i] = (float) r[i];
+        }
+        lu_kernel_solve_float(lu, n, lda, pivots, correction);
+        data_t x_norm = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            x[i] += correction[i];
+            x_norm = fmax(x_norm, fabs(x[i]));
+        }
+        data_t r_norm = residual_norm(a, f, column, x, r);
+        if (!isfinite(r_norm)) {
+            return 0;
+        }
+        if (r_norm <= x_norm * threshold) {
+            *refinements = step > *refinements ? step : *refinements;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static _Bool solve_single(Matrix *a, Matrix *f, Matrix *answ, size_t *refinements, int *status)
+{
+    PROFILE_BEGIN("mixed_single");
+    size_t n = a->row, lda;
+    float *lu = new_kernel_matrix(n, sizeof(float), &lda);
+    size_t *pivots = malloc((n + 1) * sizeof(*pivots));
+    data_t *work = malloc((2 * n + 1) * sizeof(*work));
+    float *correction = malloc((n + 1) * sizeof(*correction));
+    if (lu == NULL || pivots == NULL || work == NULL || correction == NULL) {
+        *status = ALLOC_FAILED;
+        free(lu);
+        free(pivots);
+        free(work);
+        free(correction);
+        return 0;
+    }
+
+    _Bool converged = to_single(a, lu, lda) && lu_kernel_factor_float(lu, n, lda, pivots);
+    if (converged) {
+        data_t a_norm = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            data_t sum = 0.0;
+            for (size_t j = 0; j < n; j++) {
+                sum += fabs(get_element(a, i, j));
+            }
+            a_norm = fmax(a_norm, sum);
+        }
+        for (size_t c = 0; c < f->col && converged; c++) {
+            converged = refine_column(a, f, c, lu, lda, pivots, a_norm, work, work + n, correction, refinements);
+            for (size_t i = 0; i < n; i++) {
+                set_element(answ, i, c, work[i]);
+            }
+        }
+    }
+
+    free(lu);
+    free(pivots);
+    free(work);
+    free(correction);
+    *status = OK;
+    return converged;
+}
+
+static void solve_double(Matrix *a, Matrix *f, Matrix *answ, int *status)
+{
+    PROFILE_BEGIN("mixed_double");
+    size_t n = a->row, lda;
+    double *lu = new_kernel_matrix(n, sizeof(double), &lda);
+    size_t *pivots = malloc((n + 1) * sizeof(*pivots));
+    double *x = malloc((n + 1) * sizeof(*x));
+    if (lu == NULL || pivots == NULL || x == NULL) {
+        *status = ALLOC_FAILED;
+        free(lu);
+        free(pivots);
+        free(x);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            lu[i * lda + j] = get_element(a, i, j);
+        }
+    }
+
+    *status = INCORRECT_ARGS; // Вырожденная матрица
+    if (lu_kernel_factor_double(lu, n, lda, pivots)) {
+        for (size_t c = 0; c < f->col; c++) {
+            for (size_t i = 0; i < n; i++) {
+                x[i] = get_element(f, i, c);
+            }
+            lu_kernel_solve_double(lu, n, lda, pivots, x);
+            for (size_t i = 0; i < n; i++) {
+                set_element(answ, i, c, x[i]);
+            }
+        }
+        *status = OK;
+    }
+    free(lu);
+    free(pivots);
+    free(x);
+}
+
+Matrix *gauss_solve_mixed(Matrix *a, Matrix *f, size_t *refinements, int *status) {
+    PROFILE_BEGIN("gauss_solve_mixed");
+    if (a == NULL || f == NULL || a->row != a->col || f->row != a->row) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Matrix *answ = new_matrix(f->row, f->col);
+    if (answ == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+
+    *refinements = 0;
+    if (!solve_single(a, f, answ, refinements, status) && *status == OK) {
+        *refinements = 0;
+        solve_double(a, f, answ, status);
+    }
+    if (*status != OK) {
+        free_matrix(answ);
+        return NULL;
+    }
+    return answ;
+}
@@ -0,0 +1,12 @@
+#ifndef LE_SOLVER_MIXED_H
+#define LE_SOLVER_MIXED_H
+
+#include "matrix.h"
+
+// Метод Гаусса в смешанной точности: разложение выполняется в одинарной точности, а точность double
+// восстанавливается итерационным уточнением по невязке. Если уточнение не сходится, что бывает для плохо
+// обусловленных матриц, система решается разложением в double. В refinements записывается число уточнений
+// или 0 при решении в double
+Matrix *gauss_solve_mixed(Matrix *a, Matrix *f, size_t *refinements, int *status);
+
+#endif //LE_SOLVER_MIXED_H
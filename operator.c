@@ -0,0 +1,126 @@
+#include <stdlib.h>
+
+#include "operator.h"
+#include "generate.h"
+#include "error.h"
+
+static Operator *new_operator(size_t n, int *status)
+{
+    Operator *a = calloc(1, sizeof(*a));
+    if (a == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    a->n = n;
+    *status = OK;
+    return a;
+}
+
+void free_operator(Operator *a) {
+    if (a == NULL) {
+        return;
+    }
+    if (a->release != NULL) {
+        a->release(a->context);
+    }
+    free(a);
+}
+
+void operator_matvec(void *a, const data_t *x, data_t *y) {
+    Operator *op = a;
+    op->matvec(op->context, x, y);
+}
+
+static void dense_operator_matvec(void *context, const data_t *x, data_t *y)
+{
+    Matrix *a = context;
+    for (size_t i = 0; i < a->row; i++) {
+        data_t sum = 0.0;
+        for (size_t j = 0; j < a->col; j++) {
+            sum += get_element(a, i, j) * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+static data_t dense_operator_element(void *context, size_t i, size_t j)
+{
+    return get_element(context, i, j);
+}
+
+static data_t dense_operator_diagonal(void *context, size_t i)
+{
+    return get_element(context, i, i);
+}
+
+Operator *new_dense_operator(Matrix *a, int *status) {
+    if (a == NULL || a->row != a->col) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Operator *op = new_operator(a->row, status);
+    if (op == NULL) {
+        return NULL;
+    }
+    op->matvec = dense_operator_matvec;
+    op->element = dense_operator_element;
+    op->diagonal = dense_operator_diagonal;
+    op->context = a;
+    return op;
+}
+
+typedef struct {
+    size_t n;
+    size_t m;
+} FunctionOperator;
+
+static data_t function_operator_element(void *context, size_t i, size_t j)
+{
+    FunctionOperator *fo = context;
+    return gen_function_a(fo->n, fo->m, i, j);
+}
+
+static data_t function_operator_diagonal(void *context, size_t i)
+{
+    FunctionOperator *fo = context;
+    return gen_function_a(fo->n, fo->m, i, i);
+}
+
+static void function_operator_matvec(void *context, const data_t *x, data_t *y)
+{
+    // Вне диагонали a_ij = c * (i + j), где c = 1 / (m + n), т.е. A = c * (u * e^T + e * u^T) + D', где u_i = i,
+    // e -- вектор из единиц, а диагональная D' исправляет диагональ. Поэтому (A * x)_i = c * (i * sum_j x_j +
+    // sum_j j * x_j) + (a_ii - 2 * c * i) * x_i, и обе суммы вычисляются один раз для всех строк
+    FunctionOperator *fo = context;
+    data_t c = 1.0 / ((data_t) fo->m + (data_t) fo->n);
+    data_t sum = 0.0, weighted_sum = 0.0;
+    for (size_t j = 0; j < fo->n; j++) {
+        sum += x[j];
+        weighted_sum += (data_t) j * x[j];
+    }
+    for (size_t i = 0; i < fo->n; i++) {
+        data_t row = (data_t) i;
+        y[i] = c * (row * sum + weighted_sum) + (gen_function_a(fo->n, fo->m, i, i) - 2.0 * c * row) * x[i];
+    }
+}
+
+Operator *new_function_operator(size_t n, size_t m, int *status) {
+    FunctionOperator *fo = malloc(sizeof(*fo));
+    if (fo == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    fo->n = n;
+    fo->m = m;
+    Operator *op = new_operator(n, status);
+    if (op == NULL) {
+        free(fo);
+        return NULL;
+    }
+    op->matvec = function_operator_matvec;
+    op->element = function_operator_element;
+    op->diagonal = function_operator_diagonal;
+    op->release = free;
+    op->context = fo;
+    return op;
+}
@@ -0,0 +1,28 @@
+#ifndef LE_SOLVER_OPERATOR_H
+#define LE_SOLVER_OPERATOR_H
+
+#include "matrix.h"
+
+// Квадратная матрица системы, заданная функциями вместо хранимых элементов. Итерационным методам достаточно
+// умножения на вектор и диагонали, поэтому для матриц с известной формулой элементов память занимают только векторы
+typedef struct {
+    size_t n;
+    void (*matvec)(void *context, const data_t *x, data_t *y); // y = A * x
+    data_t (*element)(void *context, size_t i, size_t j);
+    data_t (*diagonal)(void *context, size_t i);
+    void (*release)(void *context); // Освобождает context, если он принадлежит оператору, иначе NULL
+    void *context;
+} Operator;
+
+// Оператор хранимой матрицы. Матрица не копируется и должна существовать, пока используется оператор
+Operator *new_dense_operator(Matrix *a, int *status);
+
+// Оператор матрицы gen_function_a размера n с параметром m, умножение на вектор выполняется за O(n)
+Operator *new_function_operator(size_t n, size_t m, int *status);
+
+void free_operator(Operator *a);
+
+// Умножение на вектор с оператором в качестве контекста, подходит для методов из krylov.h
+void operator_matvec(void *a, const data_t *x, data_t *y);
+
+#endif //LE_SOLVER_OPERATOR_H
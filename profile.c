@@ -0,0 +1,123 @@
+#include "profile.h"
+
+#ifdef LE_SOLVER_PROFILE
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Наибольшее число различных этапов
+#define PROFILE_MAX_ENTRIES 64
+
+static ProfileEntry entries[PROFILE_MAX_ENTRIES];
+static size_t entry_count = 0;
+static int entries_lock = 0;
+static ProfileEntry overflow_entry = {"other", 0, 0, 0, 0, 0};
+
+static _Thread_local ProfileTimer *current = NULL;
+
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * UINT64_C(1000000000) + (uint64_t) time.tv_nsec;
+}
+
+// Регистрирует этап. Вызывается один раз для каждого места вызова PROFILE_BEGIN, поэтому блокировка не влияет
+// на накладные расходы
+static ProfileEntry *find_entry(const char *name)
+{
+    while (__atomic_exchange_n(&entries_lock, 1, __ATOMIC_ACQUIRE)) {
+    }
+    ProfileEntry *entry = NULL;
+    for (size_t i = 0; i < entry_count && entry == NULL; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            entry = &entries[i];
+        }
+    }
+    if (entry == NULL) {
+        entry = entry_count < PROFILE_MAX_ENTRIES ? &entries[entry_count++] : &overflow_entry;
+        if (entry != &overflow_entry) {
+            entry->name = name;
+        }
+    }
+    __atomic_store_n(&entries_lock, 0, __ATOMIC_RELEASE);
+    return entry;
+}
+
+void profile_begin(ProfileTimer *timer, ProfileEntry **cache, const char *name) {
+    ProfileEntry *entry = __atomic_load_n(cache, __ATOMIC_ACQUIRE);
+    if (entry == NULL) {
+        entry = find_entry(name);
+        __atomic_store_n(cache, entry, __ATOMIC_RELEASE);
+    }
+    timer->entry = entry;
+    timer->parent = current;
+    current = timer;
+    timer->start = now();
+}
+
+void profile_end(ProfileTimer *timer) {
+    uint64_t elapsed = now() - timer->start;
+    __atomic_fetch_add(&timer->entry->nanoseconds, elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&timer->entry->calls, 1, __ATOMIC_RELAXED);
+    current = timer->parent;
+}
+
+void profile_count(uint64_t flops, uint64_t bytes, uint64_t iters) {
+    if (current == NULL) { // Вне этапов счётчики не учитываются
+        return;
+    }
+    ProfileEntry *entry = current->entry;
+    __atomic_fetch_add(&entry->flops, flops, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->iters, iters, __ATOMIC_RELAXED);
+}
+
+void profile_report(FILE *file, _Bool json) {
+    size_t count = __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE);
+    if (json) {
+        fputs("[", file);
+    } else {
+        fprintf(file, "%-24s %10s %14s %10s %14s %14s %10s\n", "phase", "calls", "seconds", "gflops",
+                "flops", "bytes", "iterations");
+    }
+    _Bool first = 1;
+    for (size_t i = 0; i <= count; i++) {
+        ProfileEntry *entry = i < count ? &entries[i] : &overflow_entry;
+        if (entry->calls == 0) {
+            continue;
+        }
+        double seconds = (double) entry->nanoseconds * 1e-9;
+        double gflops = seconds > 0.0 ? (double) entry->flops / seconds * 1e-9 : 0.0;
+        if (json) {
+            fprintf(file, "%s\n  {\"phase\": \"%s\", \"calls\": %llu, \"seconds\": %.9f, \"flops\": %llu, "
+                          "\"gflops\": %.6f, \"bytes\": %llu, \"iterations\": %llu}", first ? "" : ",", entry->name,
+                    (unsigned long long) entry->calls, seconds, (unsigned long long) entry->flops, gflops,
+                    (unsigned long long) entry->bytes, (unsigned long long) entry->iters);
+        } else {
+            fprintf(file, "%-24s %10llu %14.6f %10.3f %14llu %14llu %10llu\n", entry->name,
+                    (unsigned long long) entry->calls, seconds, gflops, (unsigned long long) entry->flops,
+                    (unsigned long long) entry->bytes, (unsigned long long) entry->iters);
+        }
+        first = 0;
+    }
+    if (json) {
+        fputs("\n]\n", file);
+    }
+}
+
+void profile_finish(void) {
+    // Путь к файлу отчёта в формате JSON задаётся переменной окружения LE_SOLVER_PROFILE_OUTPUT, иначе сводка
+    // выводится на стандартный поток ошибок
+    const char *path = getenv("LE_SOLVER_PROFILE_OUTPUT");
+    FILE *file = path != NULL ? fopen(path, "w") : NULL;
+    if (file == NULL) {
+        profile_report(stderr, 0);
+        return;
+    }
+    profile_report(file, 1);
+    fclose(file);
+}
+
+#endif
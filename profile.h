@@ -0,0 +1,53 @@
+#ifndef LE_SOLVER_PROFILE_H
+#define LE_SOLVER_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Счётчики этапов вычислений: время, число операций, объём выделенной памяти и число итераций. Включаются при
+// сборке с параметром -DLE_SOLVER_PROFILE=ON, иначе макросы не порождают кода и аргументы не вычисляются
+#ifdef LE_SOLVER_PROFILE
+
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    uint64_t nanoseconds; // Время этапа включает время вложенных этапов
+    uint64_t flops;
+    uint64_t bytes;
+    uint64_t iters;
+} ProfileEntry;
+
+typedef struct ProfileTimer {
+    ProfileEntry *entry;
+    struct ProfileTimer *parent; // Объемлющий этап того же потока
+    uint64_t start;
+} ProfileTimer;
+
+void profile_begin(ProfileTimer *timer, ProfileEntry **cache, const char *name);
+
+void profile_end(ProfileTimer *timer);
+
+void profile_count(uint64_t flops, uint64_t bytes, uint64_t iters);
+
+void profile_report(FILE *file, _Bool json);
+
+void profile_finish(void);
+
+// Этап длится до выхода из блока, в котором записан макрос, поэтому в блоке допускается только один этап
+#define PROFILE_BEGIN(name) \
+    static ProfileEntry *profile_cache_ = NULL; \
+    ProfileTimer profile_timer_ __attribute__((cleanup(profile_end))); \
+    profile_begin(&profile_timer_, &profile_cache_, name)
+// Счётчики добавляются к самому вложенному этапу текущего потока
+#define PROFILE_COUNT(flops, bytes, iters) profile_count((uint64_t) (flops), (uint64_t) (bytes), (uint64_t) (iters))
+#define PROFILE_FINISH() profile_finish()
+
+#else
+
+#define PROFILE_BEGIN(name) ((void) 0)
+#define PROFILE_COUNT(flops, bytes, iters) ((void) 0)
+#define PROFILE_FINISH() ((void) 0)
+
+#endif
+
+#endif //LE_SOLVER_PROFILE_H
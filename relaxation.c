@@ -1,39 +1,178 @@
+#include <float.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "relaxation.h"
 #include "error.h"
+#include "threads.h"
+#include "profile.h"
+
+static Matrix *normal_system(Matrix *a, Matrix *f, Matrix **normal_f, int *status);
+
+// Одна итерация метода верхней релаксации над приближением x, возвращает квадрат расстояния между приближениями
+typedef data_t (*sweep_t)(void *context, Matrix *x, data_t omega);
+
+// Итерация по явно построенной матрице системы. Если f == NULL, правая часть считается нулевой
+typedef struct {
+    Matrix *a;
+    Matrix *f;
+    _Bool symmetric; // За прямым проходом по неизвестным следует обратный, как в симметричном методе
+} DenseSweep;
+
+static data_t dense_sweep(void *context, Matrix *x, data_t omega);
+
+// Итерация для системы A^T * A * x = A^T * f по невязке r = f - A * x, см. relaxation_normal
+typedef struct {
+    Matrix *a;
+    Matrix *residual;
+    Matrix *diagonal; // Диагональ A^T * A
+} NormalSweep;
+
+static data_t normal_sweep(void *context, Matrix *x, data_t omega);
+
+// То же, что и NormalSweep, но столбцы A берутся из строк t = A^T в формате CSR
+typedef struct {
+    SparseMatrix *t;
+    Matrix *residual;
+    Matrix *diagonal;
+} SparseSweep;
+
+static data_t sparse_sweep(void *context, Matrix *x, data_t omega);
+
+static void init_error(Matrix *x);
+static data_t estimate_radius(sweep_t sweep, void *context, Matrix *x, Matrix *residual, data_t omega);
+static data_t symmetric_radius(DenseSweep *sweep, Matrix *x, data_t omega);
+static data_t select_omega(sweep_t sweep, void *context, Matrix *x, Matrix *residual);
+static data_t dense_omega(Matrix *a);
 
 Matrix *relaxation(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status) {
+    return relaxation_history(a, f, omega, precision, SIZE_MAX, NULL, NULL, iters, status);
+}
+
+Matrix *relaxation_history(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t max_iters,
+                           relaxation_history_t history, void *context, size_t *iters, int *status) {
+    PROFILE_BEGIN("relaxation");
     if (a == NULL || f == NULL || a->col != a->row || f->row != a->row) {
         *status = INCORRECT_ARGS;
         return NULL;
     }
 
-    // Матрица A должна удовлетворять условиям теоремы Самарского, т.е. быть самосопряженной, для этого домножим
-    // систему уравнений с обоих сторон на A^T получая систему A^T * A * x = A^T * f
-    Matrix *tm = transpose(a);
-    if (tm == NULL) {
-        *status = ALLOC_FAILED;
+    if ((a = normal_system(a, f, &f, status)) == NULL) {
         return NULL;
     }
-    if ((a = matrix_mul(tm, a)) == NULL) {
+
+    // Используется только один вектор решения, т.к. не требуется одновременно хранить x_i для более чем одной итерации,
+    // т.к. x_i вычисляются последовательно. Столбцы правой части решаются одновременно: строка матрицы читается один
+    // раз на все столбцы
+    size_t cols = f->col;
+    Matrix *solution_cur = new_matrix(a->row, cols);
+    data_t *sums = malloc(cols * sizeof(*sums) + 1);
+    if (solution_cur == NULL || sums == NULL) {
         *status = ALLOC_FAILED;
-        free_matrix(tm);
+        free_matrix(solution_cur);
+        free(sums);
+        free_matrix(a);
+        free_matrix(f);
         return NULL;
     }
-    if ((f = matrix_mul(tm, f)) == NULL) {
+    if (!(omega > 0.0) && !((omega = dense_omega(a)) > 0.0)) {
         *status = ALLOC_FAILED;
+        free_matrix(solution_cur);
+        free(sums);
         free_matrix(a);
-        free_matrix(tm);
+        free_matrix(f);
         return NULL;
     }
-    free_matrix(tm);
 
-    // Используется только один вектор решения, т.к. не требуется одновременно хранить x_i для более чем одной итерации,
-    // т.к. x_i вычисляются последовательно
+    *iters = 0;
+    data_t distance_squared;
+    do {
+        distance_squared = 0.0; // Аккумулируем расстояние между векторами двух итераций нахождения решения
+        for (size_t i = 0; i < a->row; i++) {
+            for (size_t c = 0; c < cols; c++) {
+                sums[c] = 0.0;
+            }
+            // Расчёт двух сум преобразуется в расчёт одной т.к. вектор-столбец решений solution_cur содержит
+            // решения из вектора solution_prev начиная с i-ой строки
+            for (size_t j = 0; j < a->row; j++) {
+                data_t element = get_element(a, i, j);
+                const data_t *known = solution_cur->values + j * solution_cur->stride;
+                for (size_t c = 0; c < cols; c++) {
+                    sums[c] += element * known[c];
+                }
+            }
+
+            for (size_t c = 0; c < cols; c++) {
+                // Находим x^(k+1)_i - x^k_i = w / a_(ii) * (f_i - sum)
+                data_t variation = omega * (get_element(f, i, c) - sums[c]) / get_element(a, i, i);
+                // Также добавляем (x^(k+1)_i - x^k_i) ^ 2 к расстоянию между между векторами двух
+                // итераций нахождения решения
+                distance_squared += pow(variation, 2);
+                set_element(solution_cur, i, c, get_element(solution_cur, i, c) + variation);
+            }
+        }
+
+        (*iters)++;
+        PROFILE_COUNT(2 * a->row * a->row * cols, 0, 1);
+        if (history != NULL) {
+            history(context, *iters, sqrt(distance_squared));
+        }
+    } while (sqrt(distance_squared) > precision && *iters < max_iters); // Оценкой точности служит
+    // |x^(k+1) - x^k| < eps, для нескольких столбцов -- по норме Фробениуса
+
+    free(sums);
+    free_matrix(a);
+    free_matrix(f);
+
+    // Как и в operator_relaxation, расходимость с переполнением до inf или nan тоже считается отсутствием сходимости
+    *status = sqrt(distance_squared) <= precision ? OK : NOT_CONVERGED;
+    return solution_cur;
+}
+
+static size_t *color_rows(Matrix *a, size_t *color_count, size_t **color_start, size_t **row_colors);
+
+Matrix *relaxation_multicolor(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status) {
+    PROFILE_BEGIN("relaxation_multicolor");
+    if (a == NULL || f == NULL || a->col != a->row || f->row != a->row || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+
+    if ((a = normal_system(a, f, &f, status)) == NULL) {
+        return NULL;
+    }
+
+    // Строки разбиваются на цвета так, что строки одного цвета не зависят друг от друга: a_ij = 0 для любых двух
+    // строк i, j одного цвета. Для ленточных матриц это даёт красно-чёрное упорядочивание
+    size_t color_count;
+    size_t *color_start, *colors;
+    size_t *rows = color_rows(a, &color_count, &color_start, &colors);
+    if (rows == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(a);
+        free_matrix(f);
+        return NULL;
+    }
     Matrix *solution_cur = new_matrix(a->row, 1);
     if (solution_cur == NULL) {
         *status = ALLOC_FAILED;
+        free(rows);
+        free(color_start);
+        free(colors);
+        free_matrix(a);
+        free_matrix(f);
+        return NULL;
+    }
+    // Радиус для автоматического выбора омега оценивается для естественного порядка неизвестных: для согласованно
+    // упорядочиваемых матриц, в т.ч. при красно-чёрном упорядочивании, он не зависит от порядка
+    if (!(omega > 0.0) && !((omega = dense_omega(a)) > 0.0)) {
+        *status = ALLOC_FAILED;
+        free(rows);
+        free(color_start);
+        free(colors);
+        free_matrix(solution_cur);
         free_matrix(a);
         free_matrix(f);
         return NULL;
@@ -42,29 +181,733 @@ Matrix *relaxation(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t
     *iters = 0;
     data_t distance_squared;
     do {
-        distance_squared = 0.0; // Аккумулируем расстояние между векторами двух итераций нахождения решения
-        for (size_t i = 0; i < a->row; i++) {
-            data_t sum = 0.0; // Расчёт двух сум преобразуется в расчёт одной т.к. вектор-столбец решений
-            // solution_cur содержит решения из вектора solution_prev начиная с i-ой строки
-            for (size_t j = 0; j < a->row; j++) {
-                sum += get_element(a, i, j) * get_element(solution_cur, j, 0);
+        distance_squared = 0.0;
+        for (size_t c = 0; c < color_count; c++) {
+            // Неизвестные одного цвета вычисляются только через неизвестные других цветов и обновляются параллельно.
+            // Неизвестные того же цвета, которые в это время изменяют другие потоки, не читаются, хотя и входят в
+            // сумму с нулевыми коэффициентами: иначе это гонка данных, а inf или nan в них дали бы nan. Если в
+            // каждом цвете по одной строке (например, A^T * A плотной матрицы), итерация выполняется последовательно
+            // и совпадает с обычной верхней релаксацией
+            size_t begin = color_start[c], end = color_start[c + 1];
+            PARALLEL_FOR(num_threads(get_thread_count()) \
+                         if(end - begin > 1 && (end - begin) * a->col > PARALLEL_THRESHOLD) \
+                         reduction(+:distance_squared) schedule(static))
+            for (size_t k = begin; k < end; k++) {
+                size_t i = rows[k];
+                data_t sum = 0.0;
+                for (size_t j = 0; j < a->row; j++) {
+                    if (colors[j] != c || j == i) {
+                        sum += get_element(a, i, j) * get_element(solution_cur, j, 0);
+                    }
+                }
+
+                data_t variation = omega * (get_element(f, i, 0) - sum) / get_element(a, i, i);
+                distance_squared += variation * variation;
+                set_element(solution_cur, i, 0, get_element(solution_cur, i, 0) + variation);
             }
+        }
 
-            // Находим x^(k+1)_i - x^k_i = w / a_(ii) * (f_i - sum)
-            data_t variation = omega * (get_element(f, i, 0) - sum) / get_element(a, i, i);
-            // Также добавляем (x^(k+1)_i - x^k_i) ^ 2 к расстоянию между между векторами двух
-            // итераций нахождения решения
-            distance_squared += pow(variation, 2);
-            //
-            set_element(solution_cur, i, 0, get_element(solution_cur, i, 0) + variation);
+        (*iters)++;
+        PROFILE_COUNT(2 * a->row * a->row, 0, 1);
+    } while (sqrt(distance_squared) > precision);
+
+    free(rows);
+    free(color_start);
+    free(colors);
+    free_matrix(a);
+    free_matrix(f);
+
+    *status = OK;
+    return solution_cur;
+}
+
+Matrix *relaxation_normal(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status) {
+    PROFILE_BEGIN("relaxation_normal");
+    if (a == NULL || f == NULL || a->col != a->row || f->row != a->row || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+
+    // Итерации совпадают с итерациями метода для системы A^T * A * x = A^T * f, но матрица A^T * A не строится:
+    // i-ая строка системы равна (A^T * (f - A * x))_i, т.е. скалярному произведению i-го столбца A на невязку
+    // r = f - A * x, которая хранится и обновляется после изменения каждой неизвестной
+    Matrix *solution_cur = new_matrix(a->row, 1);
+    if (solution_cur == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    Matrix *residual = copy_matrix(f); // При нулевом начальном приближении r = f
+    if (residual == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(solution_cur);
+        return NULL;
+    }
+    Matrix *diagonal = new_matrix(a->row, 1); // Диагональ A^T * A -- квадраты норм столбцов A
+    if (diagonal == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(residual);
+        free_matrix(solution_cur);
+        return NULL;
+    }
+    for (size_t k = 0; k < a->row; k++) {
+        for (size_t i = 0; i < a->col; i++) {
+            data_t element = get_element(a, k, i);
+            set_element(diagonal, i, 0, get_element(diagonal, i, 0) + element * element);
         }
+    }
+
+    NormalSweep sweep = {a, residual, diagonal};
+    if (!(omega > 0.0)) {
+        // Для однородной системы с начальной ошибкой e невязка равна -A * e
+        init_error(solution_cur);
+        for (size_t k = 0; k < a->row; k++) {
+            data_t sum = 0.0;
+            for (size_t i = 0; i < a->col; i++) {
+                sum += get_element(a, k, i) * get_element(solution_cur, i, 0);
+            }
+            set_element(residual, k, 0, -sum);
+        }
+        omega = select_omega(normal_sweep, &sweep, solution_cur, residual);
+        memset(solution_cur->values, 0, a->row * sizeof(*solution_cur->values));
+        for (size_t k = 0; k < a->row; k++) {
+            set_element(residual, k, 0, get_element(f, k, 0));
+        }
+    }
+
+    *iters = 0;
+    data_t distance_squared;
+    do {
+        distance_squared = normal_sweep(&sweep, solution_cur, omega);
 
         (*iters)++;
-    } while (sqrt(distance_squared) > precision); // Оценкой точности служит |x^(k+1) - x^k| < eps
+        PROFILE_COUNT(4 * a->row * a->row, 0, 1);
+    } while (sqrt(distance_squared) > precision);
+
+    free_matrix(diagonal);
+    free_matrix(residual);
+
+    *status = OK;
+    return solution_cur;
+}
+
+Matrix *relaxation_chebyshev(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status) {
+    PROFILE_BEGIN("relaxation_chebyshev");
+    if (a == NULL || f == NULL || a->col != a->row || f->row != a->row || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+
+    if ((a = normal_system(a, f, &f, status)) == NULL) {
+        return NULL;
+    }
 
+    // Матрица перехода симметричного метода подобна симметричной, её собственные значения лежат в [0, rho), поэтому
+    // к итерациям x_(k+1) = S(x_k) применимо ускорение Чебышёва:
+    // x_(k+1) = w_(k+1) * (S(x_k) - x_(k-1)) + x_(k-1), w_1 = 1, w_2 = 1 / (1 - rho^2 / 2),
+    // w_(k+1) = 1 / (1 - rho^2 * w_k / 4). При заниженной оценке rho ускорение почти пропадает, поэтому радиус
+    // находится методом Ланцоша (symmetric_radius), а не степенным методом
+    Matrix *solution_cur = new_matrix(a->row, 1);
+    Matrix *solution_prev = new_matrix(a->row, 1);
+    Matrix *solution_next = new_matrix(a->row, 1);
+    if (solution_cur == NULL || solution_prev == NULL || solution_next == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(solution_next);
+        free_matrix(solution_prev);
+        free_matrix(solution_cur);
+        free_matrix(a);
+        free_matrix(f);
+        return NULL;
+    }
+
+    DenseSweep sweep = {a, NULL, 1};
+    init_error(solution_cur);
+    if (!(omega > 0.0)) {
+        omega = select_omega(dense_sweep, &sweep, solution_cur, NULL);
+    }
+    data_t radius = symmetric_radius(&sweep, solution_cur, omega);
+    if (!(radius >= 0.0)) {
+        *status = ALLOC_FAILED;
+        free_matrix(solution_next);
+        free_matrix(solution_prev);
+        free_matrix(solution_cur);
+        free_matrix(a);
+        free_matrix(f);
+        return NULL;
+    }
+    memset(solution_cur->values, 0, a->row * sizeof(*solution_cur->values));
+    sweep.f = f;
+
+    *iters = 0;
+    data_t weight = 1.0;
+    data_t distance_squared;
+    do {
+        // Оценкой точности служит расстояние между x_k и S(x_k). Проход выполняется над копией x_k, т.к. x_k
+        // понадобится как x_(k-1) на следующей итерации. Затем векторы x_(k-1), x_k, x_(k+1) сдвигаются по кругу
+        memcpy(solution_next->values, solution_cur->values, a->row * sizeof(*solution_next->values));
+        distance_squared = dense_sweep(&sweep, solution_next, omega);
+        for (size_t i = 0; i < a->row; i++) {
+            set_element(solution_next, i, 0,
+                        weight * get_element(solution_next, i, 0) + (1.0 - weight) * get_element(solution_prev, i, 0));
+        }
+        Matrix *swap = solution_prev;
+        solution_prev = solution_cur;
+        solution_cur = solution_next;
+        solution_next = swap;
+
+        weight = *iters == 0 ? 1.0 / (1.0 - radius * radius / 2.0) : 1.0 / (1.0 - radius * radius * weight / 4.0);
+        (*iters)++;
+        PROFILE_COUNT(4 * a->row * a->row + 3 * a->row, 0, 1);
+    } while (sqrt(distance_squared) > precision);
+
+    free_matrix(solution_next);
+    free_matrix(solution_prev);
     free_matrix(a);
     free_matrix(f);
 
     *status = OK;
     return solution_cur;
 }
+
+Matrix *sparse_relaxation(SparseMatrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status) {
+    PROFILE_BEGIN("sparse_relaxation");
+    if (a == NULL || f == NULL || a->col != a->row || f->row != a->row || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+
+    // Итерации те же, что и в relaxation_normal, но столбцы A берутся из строк A^T в формате CSR, поэтому
+    // каждая итерация обходит только ненулевые элементы
+    SparseMatrix *t = sparse_transpose(a, status);
+    if (t == NULL) {
+        return NULL;
+    }
+    Matrix *solution_cur = new_matrix(a->row, 1);
+    Matrix *residual = copy_matrix(f);
+    Matrix *diagonal = new_matrix(a->row, 1);
+    if (solution_cur == NULL || residual == NULL || diagonal == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(diagonal);
+        free_matrix(residual);
+        free_matrix(solution_cur);
+        free_sparse_matrix(t);
+        return NULL;
+    }
+    for (size_t i = 0; i < t->row; i++) {
+        data_t sum = 0.0;
+        for (size_t k = t->row_start[i]; k < t->row_start[i + 1]; k++) {
+            sum += t->values[k] * t->values[k];
+        }
+        set_element(diagonal, i, 0, sum);
+    }
+
+    SparseSweep sweep = {t, residual, diagonal};
+    if (!(omega > 0.0)) {
+        init_error(solution_cur);
+        memset(residual->values, 0, a->row * sizeof(*residual->values));
+        for (size_t i = 0; i < t->row; i++) { // r = -A * e, столбцы A -- строки t
+            for (size_t k = t->row_start[i]; k < t->row_start[i + 1]; k++) {
+                size_t row = t->col_idx[k];
+                set_element(residual, row, 0,
+                            get_element(residual, row, 0) - t->values[k] * get_element(solution_cur, i, 0));
+            }
+        }
+        omega = select_omega(sparse_sweep, &sweep, solution_cur, residual);
+        memset(solution_cur->values, 0, a->row * sizeof(*solution_cur->values));
+        for (size_t k = 0; k < a->row; k++) {
+            set_element(residual, k, 0, get_element(f, k, 0));
+        }
+    }
+
+    *iters = 0;
+    data_t distance_squared;
+    do {
+        distance_squared = sparse_sweep(&sweep, solution_cur, omega);
+
+        (*iters)++;
+        PROFILE_COUNT(2 * a->nnz, 0, 1);
+    } while (sqrt(distance_squared) > precision);
+
+    free_matrix(diagonal);
+    free_matrix(residual);
+    free_sparse_matrix(t);
+
+    *status = OK;
+    return solution_cur;
+}
+
+static data_t operator_omega(Operator *a, const data_t *inverse_diagonal, Matrix *x, data_t *y);
+
+Matrix *operator_relaxation(Operator *a, Matrix *f, data_t omega, data_t precision, size_t max_iters, size_t *iters,
+                            int *status) {
+    PROFILE_BEGIN("operator_relaxation");
+    if (a == NULL || f == NULL || a->matvec == NULL || a->diagonal == NULL || f->row != a->n || f->col != 1) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+
+    // x_(k+1) = x_k + w * D^-1 * (f - A * x_k), где D -- диагональ A
+    size_t n = a->n;
+    Matrix *solution_cur = new_matrix(n, 1);
+    data_t *work = malloc((2 * n + 1) * sizeof(*work));
+    if (solution_cur == NULL || work == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(solution_cur);
+        free(work);
+        return NULL;
+    }
+    data_t *inverse_diagonal = work, *product = work + n;
+    for (size_t i = 0; i < n; i++) {
+        data_t diagonal = a->diagonal(a->context, i);
+        if (!(fabs(diagonal) > 0.0)) {
+            *status = INCORRECT_ARGS;
+            free_matrix(solution_cur);
+            free(work);
+            return NULL;
+        }
+        inverse_diagonal[i] = 1.0 / diagonal;
+    }
+    if (!(omega > 0.0)) {
+        omega = operator_omega(a, inverse_diagonal, solution_cur, product);
+        memset(solution_cur->values, 0, n * sizeof(*solution_cur->values));
+    }
+
+    *iters = 0;
+    data_t distance_squared;
+    do {
+        a->matvec(a->context, solution_cur->values, product);
+        distance_squared = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            data_t variation = omega * (get_element(f, i, 0) - product[i]) * inverse_diagonal[i];
+            distance_squared += variation * variation;
+            set_element(solution_cur, i, 0, get_element(solution_cur, i, 0) + variation);
+        }
+
+        (*iters)++;
+        PROFILE_COUNT(4 * n, 0, 1);
+    } while (sqrt(distance_squared) > precision && *iters < max_iters);
+
+    free(work);
+    // Сравнение записано так, чтобы расходимость с переполнением до inf или nan тоже считалась отсутствием сходимости
+    *status = sqrt(distance_squared) <= precision ? OK : NOT_CONVERGED;
+    return solution_cur;
+}
+
+#define OPERATOR_POWER_STEPS 200
+#define OPERATOR_POWER_TOLERANCE 1e-4
+
+// Собственное значение D^-1 * A наибольшего по модулю отклонения от shift, находится степенным методом для
+// D^-1 * A - shift * I. Собственные значения D^-1 * A вещественны, если A симметрична и положительно определена,
+// т.к. эта матрица подобна D^-1/2 * A * D^-1/2
+static data_t operator_eigenvalue(Operator *a, const data_t *inverse_diagonal, data_t shift, Matrix *x, data_t *y)
+{
+    size_t n = a->n;
+    init_error(x);
+    data_t value = 0.0;
+    for (size_t step = 0; step < OPERATOR_POWER_STEPS; step++) {
+        data_t norm = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            norm += get_element(x, i, 0) * get_element(x, i, 0);
+        }
+        norm = sqrt(norm);
+        if (!(norm > 0.0)) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            set_element(x, i, 0, get_element(x, i, 0) / norm);
+        }
+
+        a->matvec(a->context, x->values, y);
+        data_t next = 0.0; // Отношение Рэлея для нормированного x
+        for (size_t i = 0; i < n; i++) {
+            y[i] = inverse_diagonal[i] * y[i] - shift * get_element(x, i, 0);
+            next += get_element(x, i, 0) * y[i];
+        }
+        memcpy(x->values, y, n * sizeof(*y));
+
+        _Bool stable = step > 0 && fabs(next - value) <= OPERATOR_POWER_TOLERANCE * fabs(next);
+        value = next;
+        if (stable) {
+            break;
+        }
+    }
+    return value + shift;
+}
+
+static data_t operator_omega(Operator *a, const data_t *inverse_diagonal, Matrix *x, data_t *y)
+{
+    PROFILE_BEGIN("operator_omega");
+    // Для собственных значений D^-1 * A из [lambda_min, lambda_max] радиус матрицы перехода I - w * D^-1 * A
+    // минимален при w = 2 / (lambda_min + lambda_max)
+    data_t lambda_max = operator_eigenvalue(a, inverse_diagonal, 0.0, x, y);
+    data_t lambda_min = operator_eigenvalue(a, inverse_diagonal, lambda_max, x, y);
+    if (!(lambda_max > 0.0)) {
+        return 1.0;
+    }
+    return lambda_min > 0.0 ? 2.0 / (lambda_min + lambda_max) : 1.0 / lambda_max;
+}
+
+static Matrix *normal_system(Matrix *a, Matrix *f, Matrix **normal_f, int *status)
+{
+    PROFILE_BEGIN("normal_system");
+    // Матрица A должна удовлетворять условиям теоремы Самарского, т.е. быть самосопряженной, для этого домножим
+    // систему уравнений с обоих сторон на A^T получая систему A^T * A * x = A^T * f
+    Matrix *tm = transpose(a);
+    if (tm == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    if ((a = matrix_mul(tm, a)) == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(tm);
+        return NULL;
+    }
+    if ((*normal_f = matrix_mul(tm, f)) == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(a);
+        free_matrix(tm);
+        return NULL;
+    }
+    free_matrix(tm);
+    return a;
+}
+
+// Возвращает строки, упорядоченные по цветам. Строки цвета c -- rows[color_start[c]..color_start[c + 1]), цвет
+// строки i -- row_colors[i]
+static size_t *color_rows(Matrix *a, size_t *color_count, size_t **color_start, size_t **row_colors)
+{
+    size_t *colors = malloc(a->row * sizeof(*colors));
+    size_t *used = malloc(a->row * sizeof(*used)); // used[c] == i + 1, если цвет c занят соседом строки i
+    size_t *rows = malloc(a->row * sizeof(*rows));
+    *color_start = calloc(a->row + 2, sizeof(**color_start));
+    if (colors == NULL || used == NULL || rows == NULL || *color_start == NULL) {
+        free(colors);
+        free(used);
+        free(rows);
+        free(*color_start);
+        return NULL;
+    }
+
+    // Жадная раскраска: строке назначается наименьший цвет, не занятый уже раскрашенными соседями
+    *color_count = 0;
+    for (size_t i = 0; i < a->row; i++) {
+        used[i] = 0;
+    }
+    for (size_t i = 0; i < a->row; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (fabs(get_element(a, i, j)) > 0.0 || fabs(get_element(a, j, i)) > 0.0) {
+                used[colors[j]] = i + 1;
+            }
+        }
+        size_t color = 0;
+        while (used[color] == i + 1) {
+            color++;
+        }
+        colors[i] = color;
+        if (color + 1 > *color_count) {
+            *color_count = color + 1;
+        }
+    }
+
+    // Сортировка строк подсчётом по цветам, строки одного цвета идут подряд начиная с color_start[c]
+    for (size_t i = 0; i < a->row; i++) {
+        (*color_start)[colors[i] + 1]++;
+    }
+    for (size_t c = 0; c < *color_count; c++) {
+        (*color_start)[c + 1] += (*color_start)[c];
+    }
+    for (size_t i = 0; i < a->row; i++) {
+        rows[(*color_start)[colors[i]]++] = i;
+    }
+    for (size_t c = *color_count; c > 0; c--) { // Восстанавливаем начала групп, сдвинутые при раскладке
+        (*color_start)[c] = (*color_start)[c - 1];
+    }
+    (*color_start)[0] = 0;
+
+    free(used);
+    *row_colors = colors;
+    return rows;
+}
+
+static data_t dense_sweep(void *context, Matrix *x, data_t omega)
+{
+    DenseSweep *sweep = context;
+    Matrix *a = sweep->a;
+    data_t distance_squared = 0.0;
+    for (size_t pass = 0; pass < (sweep->symmetric ? 2 : 1); pass++) {
+        for (size_t k = 0; k < a->row; k++) {
+            size_t i = pass == 0 ? k : a->row - 1 - k;
+            data_t sum = 0.0;
+            for (size_t j = 0; j < a->row; j++) {
+                sum += get_element(a, i, j) * get_element(x, j, 0);
+            }
+
+            data_t variation = omega * ((sweep->f != NULL ? get_element(sweep->f, i, 0) : 0.0) - sum) /
+                               get_element(a, i, i);
+            distance_squared += variation * variation;
+            set_element(x, i, 0, get_element(x, i, 0) + variation);
+        }
+    }
+    return distance_squared;
+}
+
+static data_t normal_sweep(void *context, Matrix *x, data_t omega)
+{
+    NormalSweep *sweep = context;
+    Matrix *a = sweep->a;
+    data_t distance_squared = 0.0;
+    for (size_t i = 0; i < a->col; i++) {
+        data_t sum = 0.0; // (A^T * r)_i = (A^T * f)_i - (A^T * A * x)_i
+        for (size_t k = 0; k < a->row; k++) {
+            sum += get_element(a, k, i) * get_element(sweep->residual, k, 0);
+        }
+
+        data_t variation = omega * sum / get_element(sweep->diagonal, i, 0);
+        distance_squared += variation * variation;
+        set_element(x, i, 0, get_element(x, i, 0) + variation);
+        for (size_t k = 0; k < a->row; k++) { // r = r - variation * A_i, где A_i -- i-ый столбец A
+            set_element(sweep->residual, k, 0, get_element(sweep->residual, k, 0) - variation * get_element(a, k, i));
+        }
+    }
+    return distance_squared;
+}
+
+static data_t sparse_sweep(void *context, Matrix *x, data_t omega)
+{
+    SparseSweep *sweep = context;
+    SparseMatrix *t = sweep->t;
+    data_t distance_squared = 0.0;
+    for (size_t i = 0; i < t->row; i++) {
+        data_t sum = 0.0;
+        for (size_t k = t->row_start[i]; k < t->row_start[i + 1]; k++) {
+            sum += t->values[k] * get_element(sweep->residual, t->col_idx[k], 0);
+        }
+
+        data_t variation = omega * sum / get_element(sweep->diagonal, i, 0);
+        distance_squared += variation * variation;
+        set_element(x, i, 0, get_element(x, i, 0) + variation);
+        for (size_t k = t->row_start[i]; k < t->row_start[i + 1]; k++) {
+            size_t row = t->col_idx[k];
+            set_element(sweep->residual, row, 0, get_element(sweep->residual, row, 0) - variation * t->values[k]);
+        }
+    }
+    return distance_squared;
+}
+
+static void init_error(Matrix *x)
+{
+    // Детерминированный псевдослучайный вектор, чтобы в начальной ошибке присутствовали все собственные векторы
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < x->row; i++) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        set_element(x, i, 0, (data_t) ((state * 0x2545F4914F6CDD1DULL) >> 11) / (data_t) (1ULL << 53) - 0.5);
+    }
+}
+
+#define RADIUS_SKIP_SWEEPS 5 // Итерации, за которые затухают составляющие ошибки с малыми собственными значениями
+#define RADIUS_MIN_SWEEPS 20
+#define RADIUS_MAX_SWEEPS 200
+#define RADIUS_TOLERANCE 2e-4
+#define RADIUS_LIMIT 0.9999
+// Метод Ланцоша останавливается, когда за RADIUS_WINDOW итераций оценка радиуса меняется меньше чем на эту долю
+// от 1 - радиус. Сравнение через несколько итераций нужно, т.к. оценка может задерживаться на следующем по величине
+// собственном значении, прежде чем перейти к наибольшему
+#define RADIUS_GAP_TOLERANCE 1e-2
+#define RADIUS_WINDOW 5
+
+static data_t estimate_radius(sweep_t sweep, void *context, Matrix *x, Matrix *residual, data_t omega)
+{
+    // Степенной метод: для однородной системы приближение совпадает с ошибкой, и отношение расстояний между
+    // приближениями соседних итераций стремится к спектральному радиусу матрицы перехода. После каждой итерации
+    // ошибка (и невязка вместе с ней) нормируется, поэтому расстояние на следующей итерации и есть это отношение.
+    // Радиус оценивается средним геометрическим отношений, т.к. при комплексных собственных значениях отношения
+    // колеблются
+    data_t log_sum = 0.0, radius = 0.0;
+    for (size_t k = 0; k < RADIUS_SKIP_SWEEPS + RADIUS_MAX_SWEEPS + 1; k++) {
+        data_t distance = sqrt(sweep(context, x, omega));
+        if (!(distance > 0.0)) { // Ошибка исчезла за конечное число итераций
+            return 0.0;
+        }
+        for (size_t i = 0; i < x->row; i++) {
+            set_element(x, i, 0, get_element(x, i, 0) / distance);
+        }
+        if (residual != NULL) {
+            for (size_t i = 0; i < residual->row; i++) {
+                set_element(residual, i, 0, get_element(residual, i, 0) / distance);
+            }
+        }
+        if (k <= RADIUS_SKIP_SWEEPS) { // Первое расстояние -- масштаб начальной ошибки, а не отношение
+            continue;
+        }
+
+        size_t measured = k - RADIUS_SKIP_SWEEPS;
+        log_sum += log(distance);
+        data_t next = exp(log_sum / (data_t) measured);
+        _Bool stable = measured >= RADIUS_MIN_SWEEPS && fabs(next - radius) < RADIUS_TOLERANCE * next;
+        radius = next;
+        if (stable) {
+            break;
+        }
+    }
+    return fmin(radius, RADIUS_LIMIT);
+}
+
+#define OMEGA_SEARCH_RADIUS 0.9 // При меньшем радиусе метода Гаусса-Зейделя формула Юнга достаточно точна
+#define OMEGA_SEARCH_STEPS 6
+#define OMEGA_MAX 1.99
+#define GOLDEN_SECTION 0.6180339887498949
+
+// Наибольшее собственное значение симметричной трёхдиагональной матрицы с диагональю alpha и поддиагональю beta
+// (m - 1 элементов) бисекцией: число отрицательных элементов последовательности Штурма равно числу собственных
+// значений, меньших x
+static data_t tridiagonal_max(const data_t *alpha, const data_t *beta, size_t m)
+{
+    data_t low = INFINITY, high = -INFINITY;
+    for (size_t i = 0; i < m; i++) { // Границы по кругам Гершгорина
+        data_t radius = (i > 0 ? fabs(beta[i - 1]) : 0.0) + (i + 1 < m ? fabs(beta[i]) : 0.0);
+        low = fmin(low, alpha[i] - radius);
+        high = fmax(high, alpha[i] + radius);
+    }
+    for (size_t step = 0; step < 100 && high - low > DBL_EPSILON * fmax(fabs(low), fabs(high)); step++) {
+        data_t x = (low + high) / 2.0, q = 1.0;
+        size_t below = 0;
+        for (size_t i = 0; i < m; i++) {
+            q = alpha[i] - x - (i > 0 ? beta[i - 1] * beta[i - 1] / q : 0.0);
+            if (fabs(q) < DBL_MIN) {
+                q = -DBL_MIN;
+            }
+            below += q < 0.0;
+        }
+        if (below < m) {
+            low = x;
+        } else {
+            high = x;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+static data_t symmetric_radius(DenseSweep *sweep, Matrix *x, data_t omega)
+{
+    // Для симметричного метода с симметричной положительно определённой матрицей B матрица перехода G = I - M^-1 * B
+    // самосопряжена в скалярном произведении (u, v)_B = u^T * B * v, а её собственные значения лежат в [0, 1).
+    // Степенной метод сходится к наибольшему из них со скоростью отношения двух наибольших, что при близких к 1
+    // значениях требует тысяч итераций, поэтому радиус находится методом Ланцоша в этом скалярном произведении:
+    // наибольшее собственное значение трёхдиагональной матрицы alpha, beta приближает его за десятки итераций.
+    // B * v вычисляется заново для каждого вектора: пересчёт по рекуррентной формуле неустойчив
+    Matrix *b = sweep->a;
+    size_t n = b->row;
+    data_t *work = malloc((3 * n + 3 * RADIUS_MAX_SWEEPS) * sizeof(*work));
+    if (work == NULL) {
+        return -1.0;
+    }
+    data_t *v = work, *v_prev = v + n, *bv = v_prev + n, *alpha = bv + n, *beta = alpha + RADIUS_MAX_SWEEPS;
+    data_t *estimates = beta + RADIUS_MAX_SWEEPS;
+
+    data_t norm_squared = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        data_t sum = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            sum += get_element(b, i, j) * get_element(x, j, 0);
+        }
+        bv[i] = sum;
+        norm_squared += sum * get_element(x, i, 0);
+    }
+    data_t norm = sqrt(norm_squared);
+    for (size_t i = 0; i < n; i++) {
+        v[i] = get_element(x, i, 0) / norm;
+        v_prev[i] = 0.0;
+        bv[i] /= norm;
+    }
+
+    data_t radius = 0.0;
+    for (size_t m = 0; m < RADIUS_MAX_SWEEPS; m++) {
+        for (size_t i = 0; i < n; i++) {
+            set_element(x, i, 0, v[i]);
+        }
+        dense_sweep(sweep, x, omega); // x = G * v
+        data_t dot = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            dot += get_element(x, i, 0) * bv[i];
+        }
+        alpha[m] = dot;
+        for (size_t i = 0; i < n; i++) {
+            set_element(x, i, 0, get_element(x, i, 0) - alpha[m] * v[i] - (m > 0 ? beta[m - 1] * v_prev[i] : 0.0));
+        }
+        norm_squared = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            data_t sum = 0.0;
+            for (size_t j = 0; j < n; j++) {
+                sum += get_element(b, i, j) * get_element(x, j, 0);
+            }
+            bv[i] = sum;
+            norm_squared += sum * get_element(x, i, 0);
+        }
+        beta[m] = sqrt(fmax(norm_squared, 0.0));
+
+        radius = estimates[m] = tridiagonal_max(alpha, beta, m + 1);
+        _Bool stable = m >= RADIUS_WINDOW &&
+                       fabs(radius - estimates[m - RADIUS_WINDOW]) < RADIUS_GAP_TOLERANCE * (1.0 - radius);
+        if (stable || !(beta[m] > 0.0)) { // При beta = 0 найдено инвариантное подпространство
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            v_prev[i] = v[i];
+            v[i] = get_element(x, i, 0) / beta[m];
+            bv[i] /= beta[m];
+        }
+    }
+    free(work);
+    return fmin(fmax(radius, 0.0), RADIUS_LIMIT);
+}
+
+static data_t select_omega(sweep_t sweep, void *context, Matrix *x, Matrix *residual)
+{
+    PROFILE_BEGIN("select_omega");
+    // Для согласованно упорядоченных матриц оптимальное омега по формуле Юнга равно 2 / (1 + sqrt(1 - rho_J^2)), где
+    // rho_J^2 = rho_GS. Матрица A^T * A в общем случае не такова, а метод Якоби для неё часто расходится, поэтому
+    // радиус Якоби не используется: rho_GS оценивается напрямую, формула Юнга даёт начальную оценку, а если
+    // сходимость медленная, омега уточняется золотым сечением по оценке радиуса rho(omega)
+    data_t gauss_seidel = estimate_radius(sweep, context, x, residual, 1.0);
+    data_t young = 2.0 / (1.0 + sqrt(1.0 - gauss_seidel));
+    if (gauss_seidel < OMEGA_SEARCH_RADIUS) {
+        return young;
+    }
+
+    data_t low = 1.0, high = fmin(young + (young - 1.0) / 2.0, OMEGA_MAX);
+    data_t left = high - GOLDEN_SECTION * (high - low), right = low + GOLDEN_SECTION * (high - low);
+    data_t left_radius = estimate_radius(sweep, context, x, residual, left);
+    data_t right_radius = estimate_radius(sweep, context, x, residual, right);
+    for (size_t step = 0; step < OMEGA_SEARCH_STEPS; step++) {
+        if (left_radius < right_radius) {
+            high = right;
+            right = left;
+            right_radius = left_radius;
+            left = high - GOLDEN_SECTION * (high - low);
+            left_radius = estimate_radius(sweep, context, x, residual, left);
+        } else {
+            low = left;
+            left = right;
+            left_radius = right_radius;
+            right = low + GOLDEN_SECTION * (high - low);
+            right_radius = estimate_radius(sweep, context, x, residual, right);
+        }
+    }
+    return left_radius < right_radius ? left : right;
+}
+
+// Омега для явно построенной матрицы по итерациям однородной системы во временном векторе. Возвращает 0 при ошибке
+// выделения памяти
+static data_t dense_omega(Matrix *a)
+{
+    Matrix *x = new_matrix(a->row, 1);
+    if (x == NULL) {
+        return 0.0;
+    }
+    DenseSweep sweep = {a, NULL, 0};
+    init_error(x);
+    data_t omega = select_omega(dense_sweep, &sweep, x, NULL);
+    free_matrix(x);
+    return omega;
+}
@@ -2,7 +2,40 @@
 #define LE_SOLVER_RELAXATION_H
 
 #include "matrix.h"
+#include "sparse.h"
+#include "operator.h"
+
+// Значение омега, при котором методы верхней релаксации выбирают его сами по оценке спектрального радиуса.
+// Автоматический выбор выполняется при любом omega <= 0
+#define RELAXATION_AUTO_OMEGA 0.0
 
 Matrix *relaxation(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status);
 
+// Вызывается после каждой итерации с её номером и расстоянием между приближениями соседних итераций
+typedef void (*relaxation_history_t)(void *context, size_t iteration, data_t distance);
+
+// Выполняется не более max_iters итераций. Если за них точность не достигнута или приближения разошлись до inf или
+// nan, возвращается последнее приближение со статусом NOT_CONVERGED
+Matrix *relaxation_history(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t max_iters,
+                           relaxation_history_t history, void *context, size_t *iters, int *status);
+
+// Остальные методы решают систему с одним столбцом правых частей, при f->col != 1 возвращается INCORRECT_ARGS
+
+// Неизвестные A^T * A раскрашиваются так, что неизвестные одного цвета не связаны и обновляются параллельно. Для
+// плотной A каждая неизвестная получает свой цвет и метод совпадает с последовательной верхней релаксацией
+Matrix *relaxation_multicolor(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status);
+
+Matrix *relaxation_normal(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status);
+
+// Симметричная верхняя релаксация с ускорением Чебышёва
+Matrix *relaxation_chebyshev(Matrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status);
+
+Matrix *sparse_relaxation(SparseMatrix *a, Matrix *f, data_t omega, data_t precision, size_t *iters, int *status);
+
+// Одновременная (по Якоби) верхняя релаксация для матрицы, заданной оператором: строки матрицы недоступны, поэтому
+// все неизвестные обновляются по невязке предыдущей итерации. Матрица не заменяется на A^T * A, метод сходится для
+// симметричных положительно определённых A при достаточно малом омега
+Matrix *operator_relaxation(Operator *a, Matrix *f, data_t omega, data_t precision, size_t max_iters, size_t *iters,
+                            int *status);
+
 #endif //LE_SOLVER_RELAXATION_H
@@ -0,0 +1,501 @@
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "algs.h"
+#include "relaxation.h"
+#include "error.h"
+#include "threads.h"
+#include "profile.h"
+
+_Static_assert(sizeof(ServerRequest) == 48, "request header must not contain padding");
+_Static_assert(sizeof(ServerResponse) == 40, "response header must not contain padding");
+
+// Наибольший размер системы и число правых частей в запросе
+#define SERVER_MAX_N 16384
+// Число запросов, ожидающих решения. Когда очередь заполнена, чтение запросов приостанавливается
+#define SERVER_QUEUE 256
+// Наибольшее число запросов соединения, ответ на которые ещё не записан. Если клиент не читает ответы, чтение его
+// запросов приостанавливается, поэтому в памяти сервера накапливается не больше SERVER_UNSENT ответов
+#define SERVER_UNSENT 256
+#define SERVER_DEFAULT_PRECISION 1e-10
+// Наибольшее число итераций верхней релаксации: без ограничения медленно сходящийся запрос навсегда занял бы поток пула
+#define SERVER_MAX_ITERS 100000
+
+typedef struct Job Job;
+
+// Ответы пишет отдельный поток соединения, поэтому потоки пула не блокируются на сокете медленного клиента
+typedef struct {
+    FILE *in;
+    int out_fd;
+    pthread_t writer;
+    pthread_mutex_t lock; // Очередь ответов, счётчик pending и флаг closed
+    pthread_cond_t ready; // В очереди появился ответ или чтение запросов закончено
+    pthread_cond_t sent; // Ответ записан
+    Job *head; // Очередь готовых ответов
+    Job *tail;
+    size_t pending; // Запросы, ответ на которые ещё не записан
+    _Bool closed; // Новых запросов не будет
+} Connection;
+
+// Запрос после решения становится элементом очереди ответов соединения
+struct Job {
+    Connection *connection;
+    ServerRequest request;
+    Matrix *a;
+    Matrix *f;
+    ServerResponse response;
+    unsigned char *values; // Решение без дополнения строк, только при response.status == OK
+    Job *next;
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t drained;
+    Job *jobs[SERVER_QUEUE];
+    size_t head;
+    size_t count;
+    size_t connections; // Соединения, которые ещё обслуживаются
+    _Bool stop;
+    pthread_t *threads;
+    size_t thread_count;
+} Pool;
+
+static int write_full(int fd, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return INCORRECT_ARGS;
+        }
+        p += written;
+        size -= (size_t) written;
+    }
+    return OK;
+}
+
+// Ставит ответ в очередь соединения. Решение копируется, т.к. матрица может находиться в области памяти потока
+static void queue_response(Job *job, Matrix *x)
+{
+    memcpy(job->response.magic, SERVER_RESPONSE_MAGIC, 4);
+    job->values = NULL;
+    job->next = NULL;
+    if (job->response.status == OK && (job->values = malloc(x->row * x->col * sizeof(data_t))) == NULL) {
+        job->response.status = ALLOC_FAILED; // Решение не помещается, клиент получает только статус
+    }
+    for (size_t i = 0; job->response.status == OK && i < x->row; i++) { // Дополнение строк не передаётся
+        memcpy(job->values + i * x->col * sizeof(data_t), x->values + i * x->stride, x->col * sizeof(data_t));
+    }
+
+    Connection *connection = job->connection;
+    pthread_mutex_lock(&connection->lock);
+    if (connection->tail != NULL) {
+        connection->tail->next = job;
+    } else {
+        connection->head = job;
+    }
+    connection->tail = job;
+    pthread_cond_signal(&connection->ready);
+    pthread_mutex_unlock(&connection->lock);
+}
+
+// Записывает ответы, пока чтение запросов не закончено или остаются запросы без ответа
+static void *writer(void *arg)
+{
+    Connection *connection = arg;
+    _Bool broken = 0; // Клиент отключился, оставшиеся ответы только освобождаются
+    pthread_mutex_lock(&connection->lock);
+    for (;;) {
+        while (connection->head == NULL && !(connection->closed && connection->pending == 0)) {
+            pthread_cond_wait(&connection->ready, &connection->lock);
+        }
+        Job *job = connection->head;
+        if (job == NULL) {
+            break;
+        }
+        if ((connection->head = job->next) == NULL) {
+            connection->tail = NULL;
+        }
+        pthread_mutex_unlock(&connection->lock);
+
+        size_t size = job->response.n * job->response.rhs * sizeof(data_t);
+        if (!broken) {
+            broken = write_full(connection->out_fd, &job->response, sizeof(job->response)) != OK ||
+                     (job->response.status == OK && write_full(connection->out_fd, job->values, size) != OK);
+        }
+        free(job->values);
+        free(job);
+
+        pthread_mutex_lock(&connection->lock);
+        connection->pending--;
+        pthread_cond_signal(&connection->sent);
+    }
+    pthread_mutex_unlock(&connection->lock);
+    return NULL;
+}
+
+// Область памяти потока сохраняется между запросами и увеличивается, только если запрос в неё не помещается
+static Matrix *solve_gauss(Job *job, Workspace **workspace, int *status)
+{
+    size_t size = gauss_workspace_size(job->request.n, job->request.rhs);
+    if (*workspace == NULL || (*workspace)->size < size) {
+        free_workspace(*workspace);
+        if ((*workspace = new_workspace(size)) == NULL) {
+            *status = ALLOC_FAILED;
+            return NULL;
+        }
+    }
+    reset_workspace(*workspace);
+    return gauss_solve_ws(job->a, job->f, job->request.method == SERVER_GAUSS_PIVOT, *workspace, status);
+}
+
+static void run_job(Job *job, Workspace **workspace)
+{
+    PROFILE_BEGIN("server_job");
+    ServerResponse *response = &job->response;
+
+    int status = INCORRECT_ARGS;
+    Matrix *x = NULL;
+    if (job->request.method == SERVER_GAUSS || job->request.method == SERVER_GAUSS_PIVOT) {
+        x = solve_gauss(job, workspace, &status);
+    } else if (job->request.method == SERVER_RELAXATION && isfinite(job->request.omega) && job->request.omega < 2.0) {
+        // При omega >= 2 метод расходится, а omega <= 0 означает автоматический выбор
+        size_t iters = 0;
+        data_t precision = job->request.precision > 0.0 ? job->request.precision : SERVER_DEFAULT_PRECISION;
+        x = relaxation_history(job->a, job->f, job->request.omega, precision, SERVER_MAX_ITERS, NULL, NULL, &iters,
+                               &status);
+        response->iters = iters;
+    }
+    response->status = x != NULL ? status : (status != OK ? status : ALLOC_FAILED);
+    free_matrix(job->a);
+    free_matrix(job->f);
+    queue_response(job, x);
+    free_matrix(x); // Матрица из области памяти не освобождается
+}
+
+static void *worker(void *arg)
+{
+    Pool *pool = arg;
+    Workspace *workspace = NULL;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (pool->count == 0) { // Очередь пуста и пул останавливается
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        Job *job = pool->jobs[pool->head];
+        pool->head = (pool->head + 1) % SERVER_QUEUE;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+        run_job(job, &workspace);
+    }
+    free_workspace(workspace);
+    return NULL;
+}
+
+static void push_job(Pool *pool, Job *job)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == SERVER_QUEUE) {
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    }
+    pool->jobs[(pool->head + pool->count) % SERVER_QUEUE] = job;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int start_pool(Pool *pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    pthread_cond_init(&pool->drained, NULL);
+    // Параллельно решаются разные запросы, поэтому внутри запроса вычисления выполняются в одном потоке
+    size_t count = get_thread_count();
+    set_thread_count(1);
+    if ((pool->threads = malloc(count * sizeof(*pool->threads))) == NULL) {
+        return ALLOC_FAILED;
+    }
+    // Сигнал SIGPIPE при записи ответа отключившемуся клиенту завершил бы сервер
+    signal(SIGPIPE, SIG_IGN);
+    for (; pool->thread_count < count; pool->thread_count++) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, worker, pool) != 0) {
+            break;
+        }
+    }
+    return pool->thread_count != 0 ? OK : ALLOC_FAILED;
+}
+
+static void stop_pool(Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t t = 0; t < pool->thread_count; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->drained);
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->lock);
+    set_thread_count(0);
+}
+
+static int read_matrix(FILE *in, Matrix *matrix)
+{
+    for (size_t i = 0; i < matrix->row; i++) {
+        if (fread(matrix->values + i * matrix->stride, sizeof(data_t), matrix->col, in) != matrix->col) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Пропускает значения запроса, который не удалось разместить, чтобы прочитать следующий
+static int skip_values(FILE *in, size_t count)
+{
+    data_t values[512];
+    while (count > 0) {
+        size_t part = count < 512 ? count : 512;
+        if (fread(values, sizeof(data_t), part, in) != part) {
+            return 0;
+        }
+        count -= part;
+    }
+    return 1;
+}
+
+// Читает запросы до конца потока и ставит их в очередь пула. Ответы на них дописывает поток writer
+static void serve_connection(Pool *pool, Connection *connection)
+{
+    ServerRequest request;
+    while (fread(&request, sizeof(request), 1, connection->in) == 1) {
+        pthread_mutex_lock(&connection->lock);
+        while (connection->pending >= SERVER_UNSENT) {
+            pthread_cond_wait(&connection->sent, &connection->lock);
+        }
+        connection->pending++;
+        pthread_mutex_unlock(&connection->lock);
+
+        Job *job = malloc(sizeof(*job));
+        if (job != NULL) {
+            memset(job, 0, sizeof(*job));
+            job->connection = connection;
+            job->request = request;
+            job->response.id = request.id;
+            job->response.n = request.n;
+            job->response.rhs = request.rhs;
+        }
+        if (job == NULL || memcmp(request.magic, SERVER_REQUEST_MAGIC, 4) != 0 || request.n == 0 ||
+            request.n > SERVER_MAX_N || request.rhs == 0 || request.rhs > SERVER_MAX_N) {
+            if (job != NULL) {
+                job->response.status = INCORRECT_ARGS;
+                queue_response(job, NULL);
+            } else { // Ответ об ошибке негде разместить, соединение закрывается
+                pthread_mutex_lock(&connection->lock);
+                connection->pending--;
+                pthread_mutex_unlock(&connection->lock);
+            }
+            break;
+        }
+        job->a = new_matrix(request.n, request.n);
+        job->f = new_matrix(request.n, request.rhs);
+        if (job->a == NULL || job->f == NULL) {
+            free_matrix(job->a);
+            free_matrix(job->f);
+            job->response.status = ALLOC_FAILED;
+            queue_response(job, NULL);
+            if (!skip_values(connection->in, request.n * (request.n + request.rhs))) {
+                break;
+            }
+            continue;
+        }
+        if (!read_matrix(connection->in, job->a) || !read_matrix(connection->in, job->f)) { // Запрос оборван
+            free_matrix(job->a);
+            free_matrix(job->f);
+            free(job);
+            pthread_mutex_lock(&connection->lock);
+            connection->pending--;
+            pthread_mutex_unlock(&connection->lock);
+            break;
+        }
+        push_job(pool, job);
+    }
+
+    pthread_mutex_lock(&connection->lock);
+    connection->closed = 1;
+    pthread_cond_signal(&connection->ready);
+    pthread_mutex_unlock(&connection->lock);
+}
+
+static Connection *new_connection(int in_fd, int out_fd)
+{
+    Connection *connection = malloc(sizeof(*connection));
+    if (connection == NULL) {
+        return NULL;
+    }
+    int fd = dup(in_fd); // Закрытие потока чтения не закрывает дескриптор, в который пишутся ответы
+    if (fd < 0 || (connection->in = fdopen(fd, "rb")) == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(connection);
+        return NULL;
+    }
+    connection->out_fd = out_fd;
+    connection->head = connection->tail = NULL;
+    connection->pending = 0;
+    connection->closed = 0;
+    pthread_mutex_init(&connection->lock, NULL);
+    pthread_cond_init(&connection->ready, NULL);
+    pthread_cond_init(&connection->sent, NULL);
+    if (pthread_create(&connection->writer, NULL, writer, connection) != 0) {
+        pthread_cond_destroy(&connection->sent);
+        pthread_cond_destroy(&connection->ready);
+        pthread_mutex_destroy(&connection->lock);
+        fclose(connection->in);
+        free(connection);
+        return NULL;
+    }
+    return connection;
+}
+
+// Дожидается записи ответов на все прочитанные запросы
+static void free_connection(Connection *connection)
+{
+    pthread_join(connection->writer, NULL);
+    fclose(connection->in);
+    pthread_cond_destroy(&connection->sent);
+    pthread_cond_destroy(&connection->ready);
+    pthread_mutex_destroy(&connection->lock);
+    free(connection);
+}
+
+int serve_stream(int in_fd, int out_fd) {
+    Pool pool;
+    int status = start_pool(&pool);
+    Connection *connection = status == OK ? new_connection(in_fd, out_fd) : NULL;
+    if (connection != NULL) {
+        serve_connection(&pool, connection);
+        free_connection(connection);
+    } else {
+        status = ALLOC_FAILED;
+    }
+    stop_pool(&pool);
+    return status;
+}
+
+typedef struct {
+    Pool *pool;
+    int fd;
+} Client;
+
+static void *client_thread(void *arg)
+{
+    Client *client = arg;
+    Pool *pool = client->pool;
+    Connection *connection = new_connection(client->fd, client->fd);
+    if (connection != NULL) {
+        serve_connection(pool, connection);
+        free_connection(connection);
+    }
+    close(client->fd);
+    free(client);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->connections == 0) {
+        pthread_cond_signal(&pool->drained);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int serve_socket(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return INCORRECT_ARGS;
+    }
+    strcpy(address.sun_path, path);
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) { // Сокет, оставшийся от предыдущего запуска
+        unlink(path);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        return INCORRECT_ARGS;
+    }
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        close(listener);
+        return INCORRECT_ARGS;
+    }
+
+    Pool pool;
+    int status = start_pool(&pool);
+    while (status == OK) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            status = INCORRECT_ARGS;
+            break;
+        }
+        // Каждое соединение читается своим потоком, а решаются запросы общим пулом
+        Client *client = malloc(sizeof(*client));
+        pthread_t thread;
+        if (client == NULL) {
+            close(fd);
+            continue;
+        }
+        client->pool = &pool;
+        client->fd = fd;
+        pthread_mutex_lock(&pool.lock);
+        pool.connections++;
+        pthread_mutex_unlock(&pool.lock);
+        if (pthread_create(&thread, NULL, client_thread, client) != 0) {
+            pthread_mutex_lock(&pool.lock);
+            pool.connections--;
+            pthread_mutex_unlock(&pool.lock);
+            close(fd);
+            free(client);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    close(listener);
+    unlink(path);
+
+    // Новые соединения не принимаются, уже принятые обслуживаются до конца
+    pthread_mutex_lock(&pool.lock);
+    while (pool.connections > 0) {
+        pthread_cond_wait(&pool.drained, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    stop_pool(&pool);
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef LE_SOLVER_SERVER_H
+#define LE_SOLVER_SERVER_H
+
+#include <stdint.h>
+
+#include "matrix.h"
+
+/*
+ * Постоянно работающий решатель. Клиент передаёт запросы -- заголовок ServerRequest, за которым следуют n * n
+ * элементов матрицы A и n * rhs элементов правых частей f по строкам в формате data_t с порядком байт машины.
+ * На каждый запрос возвращается заголовок ServerResponse и, если status равен OK, n * rhs элементов решения.
+ * Запросы решаются параллельно пулом потоков, поэтому ответы приходят в порядке готовности и сопоставляются
+ * с запросами по id. После некорректного заголовка соединение закрывается, т.к. граница следующего запроса неизвестна
+ */
+#define SERVER_REQUEST_MAGIC "LESQ"
+#define SERVER_RESPONSE_MAGIC "LESR"
+
+enum {
+    SERVER_GAUSS = 1,
+    SERVER_GAUSS_PIVOT,
+    SERVER_RELAXATION
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t method;
+    uint64_t id;
+    uint64_t n;
+    uint64_t rhs; // Число столбцов f
+    double omega; // Параметр верхней релаксации, при omega <= 0 подбирается автоматически, omega >= 2 -- ошибка
+    double precision; // Точность верхней релаксации, при precision <= 0 -- 1e-10
+} ServerRequest;
+
+typedef struct {
+    char magic[4];
+    int32_t status;
+    uint64_t id;
+    uint64_t n;
+    uint64_t rhs;
+    uint64_t iters; // Число итераций верхней релаксации, при NOT_CONVERGED точность не достигнута
+} ServerResponse;
+
+// Запросы читаются из in_fd, а ответы пишутся в out_fd до конца входного потока
+int serve_stream(int in_fd, int out_fd);
+
+// Соединения с сокетом path принимаются, пока не произойдёт ошибка
+int serve_socket(const char *path);
+
+#endif //LE_SOLVER_SERVER_H
@@ -0,0 +1,183 @@
+#include <stdint.h>
+
+#include "small.h"
+#include "error.h"
+#include "profile.h"
+
+// Число систем в пакете -- ширина векторного регистра, доступного при сборке. Более широкий тип, чем регистр,
+// компилятор разбивает на части, а сравнения -- на отдельные элементы, что делает ядра в несколько раз медленнее
+#if defined(__AVX512F__)
+#define SMALL_LANES 8
+#elif defined(__AVX__)
+#define SMALL_LANES 4
+#else
+#define SMALL_LANES 2 // SSE2 и NEON
+#endif
+_Static_assert(SMALL_LANES <= SMALL_MAX_LANES, "SMALL_MAX_LANES is too small");
+
+typedef data_t small_lane_t __attribute__((vector_size(SMALL_LANES * sizeof(data_t))));
+// Пакет передаётся массивом data_t, выровненным только по элементу, поэтому ядра обращаются к нему через этот тип
+typedef small_lane_t small_packed_t __attribute__((aligned(sizeof(data_t)), may_alias));
+
+// Результат сравнения small_lane_t -- маска из единиц в элементах, где условие выполнено
+typedef int64_t small_mask_t __attribute__((vector_size(SMALL_LANES * sizeof(data_t))));
+
+#define LANE_SELECT(mask, x, y) ((small_lane_t) (((small_mask_t) (x) & (mask)) | ((small_mask_t) (y) & ~(mask))))
+#define LANE_ABS(x, sign) ((small_lane_t) ((small_mask_t) (x) & ~(sign)))
+#define LANE_SWAP(x, y, mask) do {             \
+        small_lane_t lane_tmp = (x);           \
+        (x) = LANE_SELECT(mask, y, x);         \
+        (y) = LANE_SELECT(mask, lane_tmp, y);  \
+    } while (0)
+
+// Ядра пишутся для произвольного n и подставляются в функции с постоянным n, поэтому циклы с известным числом
+// итераций разворачиваются компилятором полностью
+#define SMALL_UNROLL _Pragma("GCC unroll 16")
+#define SMALL_INLINE static inline __attribute__((always_inline))
+
+// Выбор главного элемента в столбце k без ветвлений: строка k по очереди сравнивается с каждой следующей и
+// меняется с ней местами в тех системах, где элемент следующей строки больше по модулю. В итоге в строке k
+// оказывается наибольший элемент, а каждая перестановка отмечается в маске swapped для учёта знака определителя
+#define PIVOT_ROWS(n, k, a, sign, SWAP_REST) do {                                                    \
+        for (size_t r = (k) + 1; r < (n); r++) {                                                    \
+            small_mask_t swapped = (small_mask_t) (LANE_ABS((a)[r * (n) + (k)], sign) >             \
+                                                   LANE_ABS((a)[(k) * (n) + (k)], sign));           \
+            SMALL_UNROLL                                                                            \
+            for (size_t j = (k); j < (n); j++) {                                                    \
+                LANE_SWAP((a)[(k) * (n) + j], (a)[r * (n) + j], swapped);                           \
+            }                                                                                       \
+            SWAP_REST                                                                               \
+        }                                                                                           \
+    } while (0)
+
+SMALL_INLINE void solve_kernel(size_t n, small_packed_t *restrict a, small_packed_t *restrict f)
+{
+    small_mask_t sign = (small_mask_t) ((small_lane_t) {0} * -1.0);
+    for (size_t k = 0; k < n; k++) {
+        PIVOT_ROWS(n, k, a, sign, LANE_SWAP(f[k], f[r], swapped););
+        small_lane_t inverse = 1.0 / a[k * n + k];
+        a[k * n + k] = inverse; // Для обратного хода хранится обратный к главному элемент
+        for (size_t r = k + 1; r < n; r++) {
+            small_lane_t coefficient = a[r * n + k] * inverse;
+            SMALL_UNROLL
+            for (size_t j = k + 1; j < n; j++) {
+                a[r * n + j] -= coefficient * a[k * n + j];
+            }
+            f[r] -= coefficient * f[k];
+        }
+    }
+    for (size_t i = n; i > 0; i--) {
+        small_lane_t sum = f[i - 1];
+        SMALL_UNROLL
+        for (size_t j = i; j < n; j++) {
+            sum -= a[(i - 1) * n + j] * f[j];
+        }
+        f[i - 1] = sum * a[(i - 1) * n + i - 1];
+    }
+}
+
+SMALL_INLINE void determinant_kernel(size_t n, small_packed_t *restrict a, small_packed_t *restrict det)
+{
+    small_mask_t sign = (small_mask_t) ((small_lane_t) {0} * -1.0);
+    small_lane_t product = (small_lane_t) {0} + 1.0;
+    for (size_t k = 0; k < n; k++) {
+        PIVOT_ROWS(n, k, a, sign, product = LANE_SELECT(swapped, -product, product););
+        small_lane_t inverse = 1.0 / a[k * n + k];
+        product *= a[k * n + k];
+        for (size_t r = k + 1; r < n; r++) {
+            small_lane_t coefficient = a[r * n + k] * inverse;
+            SMALL_UNROLL
+            for (size_t j = k + 1; j < n; j++) {
+                a[r * n + j] -= coefficient * a[k * n + j];
+            }
+        }
+    }
+    *det = product;
+}
+
+SMALL_INLINE void inverse_kernel(size_t n, small_packed_t *restrict a, small_packed_t *restrict inv)
+{
+    small_mask_t sign = (small_mask_t) ((small_lane_t) {0} * -1.0);
+    for (size_t i = 0; i < n * n; i++) {
+        inv[i] = (small_lane_t) {0} + (i % (n + 1) == 0 ? 1.0 : 0.0);
+    }
+    for (size_t k = 0; k < n; k++) {
+        PIVOT_ROWS(n, k, a, sign, for (size_t j = 0; j < n; j++) {
+            LANE_SWAP(inv[k * n + j], inv[r * n + j], swapped);
+        });
+        small_lane_t inverse = 1.0 / a[k * n + k];
+        SMALL_UNROLL
+        for (size_t j = k + 1; j < n; j++) {
+            a[k * n + j] *= inverse;
+        }
+        SMALL_UNROLL
+        for (size_t j = 0; j < n; j++) {
+            inv[k * n + j] *= inverse;
+        }
+        for (size_t r = 0; r < n; r++) { // Исключение выполняется и над предыдущими строками
+            if (r == k) {
+                continue;
+            }
+            small_lane_t coefficient = a[r * n + k];
+            SMALL_UNROLL
+            for (size_t j = k + 1; j < n; j++) {
+                a[r * n + j] -= coefficient * a[k * n + j];
+            }
+            SMALL_UNROLL
+            for (size_t j = 0; j < n; j++) {
+                inv[r * n + j] -= coefficient * inv[k * n + j];
+            }
+        }
+    }
+}
+
+typedef void (*small_kernel_t)(small_packed_t *a, small_packed_t *out);
+
+#define SMALL_SIZES(X) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+
+#define SMALL_KERNELS(N)                                                                                   \
+    static void solve_##N(small_packed_t *a, small_packed_t *f) { solve_kernel(N, a, f); }                 \
+    static void determinant_##N(small_packed_t *a, small_packed_t *det) { determinant_kernel(N, a, det); } \
+    static void inverse_##N(small_packed_t *a, small_packed_t *inv) { inverse_kernel(N, a, inv); }
+
+SMALL_SIZES(SMALL_KERNELS)
+
+#define SOLVE_ENTRY(N) [N] = solve_##N,
+#define DETERMINANT_ENTRY(N) [N] = determinant_##N,
+#define INVERSE_ENTRY(N) [N] = inverse_##N,
+
+static const small_kernel_t solve_kernels[SMALL_MAX_N + 1] = {SMALL_SIZES(SOLVE_ENTRY)};
+static const small_kernel_t determinant_kernels[SMALL_MAX_N + 1] = {SMALL_SIZES(DETERMINANT_ENTRY)};
+static const small_kernel_t inverse_kernels[SMALL_MAX_N + 1] = {SMALL_SIZES(INVERSE_ENTRY)};
+
+static void run_kernel(const small_kernel_t *kernels, size_t n, data_t *a, data_t *out, int *status)
+{
+    if (n < SMALL_MIN_N || n > SMALL_MAX_N || a == NULL || out == NULL) {
+        *status = INCORRECT_ARGS;
+        return;
+    }
+    kernels[n]((small_packed_t *) a, (small_packed_t *) out);
+    *status = OK;
+}
+
+size_t small_lanes(void) {
+    return SMALL_LANES;
+}
+
+void small_solve(size_t n, data_t *a, data_t *f, int *status) {
+    PROFILE_BEGIN("small_solve");
+    PROFILE_COUNT(SMALL_LANES * (2 * n * n * n / 3 + 2 * n * n), 0, 0);
+    run_kernel(solve_kernels, n, a, f, status);
+}
+
+void small_determinant(size_t n, data_t *a, data_t *det, int *status) {
+    PROFILE_BEGIN("small_determinant");
+    PROFILE_COUNT(SMALL_LANES * 2 * n * n * n / 3, 0, 0);
+    run_kernel(determinant_kernels, n, a, det, status);
+}
+
+void small_inverse(size_t n, data_t *a, data_t *inv, int *status) {
+    PROFILE_BEGIN("small_inverse");
+    PROFILE_COUNT(SMALL_LANES * 2 * n * n * n, 0, 0);
+    run_kernel(inverse_kernels, n, a, inv, status);
+}
@@ -0,0 +1,27 @@
+#ifndef LE_SOLVER_SMALL_H
+#define LE_SOLVER_SMALL_H
+
+#include "matrix.h"
+
+// Ядра для пакетов систем малого размера n = SMALL_MIN_N..SMALL_MAX_N. Пакет из small_lanes() систем одного размера
+// хранится как структура массивов: элемент (i, j) матрицы системы l находится в a[(i * n + j) * small_lanes() + l],
+// поэтому каждая операция над элементами (i, j) всех систем пакета выполняется одной векторной инструкцией
+#define SMALL_MIN_N 2
+#define SMALL_MAX_N 16
+// Наибольшее значение small_lanes(), достаточное для буферов под пакет при любом наборе инструкций
+#define SMALL_MAX_LANES 8
+
+// Число систем в пакете -- ширина векторного регистра, доступного при сборке библиотеки. Определяется во время
+// выполнения, поэтому не зависит от флагов, с которыми собран вызывающий код
+size_t small_lanes(void);
+
+// Метод Гаусса с выбором главного элемента по столбцу. Матрицы a (n * n) разрушаются, решения записываются в f (n)
+void small_solve(size_t n, data_t *a, data_t *f, int *status);
+
+// Матрицы a разрушаются, определители записываются в det
+void small_determinant(size_t n, data_t *a, data_t *det, int *status);
+
+// Метод Гаусса-Жордана с выбором главного элемента по столбцу. Матрицы a разрушаются, обратные записываются в inv
+void small_inverse(size_t n, data_t *a, data_t *inv, int *status);
+
+#endif //LE_SOLVER_SMALL_H
@@ -0,0 +1,328 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sparse.h"
+#include "error.h"
+
+SparseMatrix *new_sparse_matrix(size_t row, size_t col, size_t nnz) {
+    SparseMatrix *matrix = malloc(sizeof(*matrix));
+    if (matrix == NULL) {
+        return NULL;
+    }
+    matrix->row = row;
+    matrix->col = col;
+    matrix->nnz = nnz;
+    matrix->row_start = calloc(row + 1, sizeof(*matrix->row_start));
+    matrix->col_idx = malloc((nnz != 0 ? nnz : 1) * sizeof(*matrix->col_idx));
+    matrix->values = malloc((nnz != 0 ? nnz : 1) * sizeof(*matrix->values));
+    if (matrix->row_start == NULL || matrix->col_idx == NULL || matrix->values == NULL) {
+        free_sparse_matrix(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+void free_sparse_matrix(SparseMatrix *matrix) {
+    if (matrix == NULL) {
+        return;
+    }
+    free(matrix->row_start);
+    free(matrix->col_idx);
+    free(matrix->values);
+    free(matrix);
+}
+
+SparseMatrix *copy_sparse_matrix(SparseMatrix *matrix) {
+    SparseMatrix *copy = new_sparse_matrix(matrix->row, matrix->col, matrix->nnz);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy->row_start, matrix->row_start, (matrix->row + 1) * sizeof(*copy->row_start));
+    memcpy(copy->col_idx, matrix->col_idx, matrix->nnz * sizeof(*copy->col_idx));
+    memcpy(copy->values, matrix->values, matrix->nnz * sizeof(*copy->values));
+    return copy;
+}
+
+SparseMatrix *sparse_from_triplets(size_t row, size_t col, size_t count, const size_t *rows, const size_t *cols,
+                                   const data_t *values, int *status) {
+    for (size_t k = 0; k < count; k++) {
+        if (rows[k] >= row || cols[k] >= col) {
+            *status = INCORRECT_ARGS;
+            return NULL;
+        }
+    }
+
+    // Тройки упорядочиваются двумя устойчивыми сортировками подсчётом: сначала по столбцам, затем по строкам
+    size_t *by_col = malloc((count != 0 ? count : 1) * sizeof(*by_col));
+    size_t *by_row = malloc((count != 0 ? count : 1) * sizeof(*by_row));
+    size_t *counter = calloc((row > col ? row : col) + 1, sizeof(*counter));
+    if (by_col == NULL || by_row == NULL || counter == NULL) {
+        *status = ALLOC_FAILED;
+        free(by_col);
+        free(by_row);
+        free(counter);
+        return NULL;
+    }
+    for (size_t k = 0; k < count; k++) {
+        counter[cols[k] + 1]++;
+    }
+    for (size_t j = 0; j < col; j++) {
+        counter[j + 1] += counter[j];
+    }
+    for (size_t k = 0; k < count; k++) {
+        by_col[counter[cols[k]]++] = k;
+    }
+    for (size_t i = 0; i <= row; i++) {
+        counter[i] = 0;
+    }
+    for (size_t k = 0; k < count; k++) {
+        counter[rows[k] + 1]++;
+    }
+    for (size_t i = 0; i < row; i++) {
+        counter[i + 1] += counter[i];
+    }
+    for (size_t k = 0; k < count; k++) {
+        by_row[counter[rows[by_col[k]]]++] = by_col[k];
+    }
+    free(by_col);
+    free(counter);
+
+    // Повторяющиеся тройки складываются, поэтому число ненулевых элементов сначала подсчитывается
+    size_t nnz = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (k == 0 || rows[by_row[k]] != rows[by_row[k - 1]] || cols[by_row[k]] != cols[by_row[k - 1]]) {
+            nnz++;
+        }
+    }
+    SparseMatrix *matrix = new_sparse_matrix(row, col, nnz);
+    if (matrix == NULL) {
+        *status = ALLOC_FAILED;
+        free(by_row);
+        return NULL;
+    }
+    size_t pos = 0;
+    for (size_t k = 0; k < count; k++) {
+        size_t t = by_row[k];
+        if (k != 0 && rows[t] == rows[by_row[k - 1]] && cols[t] == cols[by_row[k - 1]]) {
+            matrix->values[pos - 1] += values[t];
+            continue;
+        }
+        matrix->col_idx[pos] = cols[t];
+        matrix->values[pos] = values[t];
+        matrix->row_start[rows[t] + 1]++;
+        pos++;
+    }
+    for (size_t i = 0; i < row; i++) {
+        matrix->row_start[i + 1] += matrix->row_start[i];
+    }
+
+    free(by_row);
+    *status = OK;
+    return matrix;
+}
+
+SparseMatrix *sparse_from_dense(Matrix *matrix, int *status) {
+    if (matrix == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t nnz = 0;
+    for (size_t i = 0; i < matrix->row; i++) {
+        for (size_t j = 0; j < matrix->col; j++) {
+            if (fabs(get_element(matrix, i, j)) > 0.0) {
+                nnz++;
+            }
+        }
+    }
+    SparseMatrix *res = new_sparse_matrix(matrix->row, matrix->col, nnz);
+    if (res == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < matrix->row; i++) {
+        for (size_t j = 0; j < matrix->col; j++) {
+            data_t element = get_element(matrix, i, j);
+            if (fabs(element) > 0.0) {
+                res->col_idx[pos] = j;
+                res->values[pos] = element;
+                pos++;
+            }
+        }
+        res->row_start[i + 1] = pos;
+    }
+    *status = OK;
+    return res;
+}
+
+SparseMatrix *sparse_transpose(SparseMatrix *matrix, int *status) {
+    SparseMatrix *res = new_sparse_matrix(matrix->col, matrix->row, matrix->nnz);
+    if (res == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    // Сортировка подсчётом по столбцам, обход строк по возрастанию сохраняет упорядоченность в строках результата
+    for (size_t k = 0; k < matrix->nnz; k++) {
+        res->row_start[matrix->col_idx[k] + 1]++;
+    }
+    for (size_t j = 0; j < res->row; j++) {
+        res->row_start[j + 1] += res->row_start[j];
+    }
+    size_t *next = malloc((res->row != 0 ? res->row : 1) * sizeof(*next));
+    if (next == NULL) {
+        *status = ALLOC_FAILED;
+        free_sparse_matrix(res);
+        return NULL;
+    }
+    for (size_t j = 0; j < res->row; j++) {
+        next[j] = res->row_start[j];
+    }
+    for (size_t i = 0; i < matrix->row; i++) {
+        for (size_t k = matrix->row_start[i]; k < matrix->row_start[i + 1]; k++) {
+            size_t pos = next[matrix->col_idx[k]]++;
+            res->col_idx[pos] = i;
+            res->values[pos] = matrix->values[k];
+        }
+    }
+    free(next);
+    *status = OK;
+    return res;
+}
+
+void sparse_mul_vector(SparseMatrix *matrix, const data_t *x, data_t *y) {
+    for (size_t i = 0; i < matrix->row; i++) {
+        data_t sum = 0.0;
+        for (size_t k = matrix->row_start[i]; k < matrix->row_start[i + 1]; k++) {
+            sum += matrix->values[k] * x[matrix->col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+static void sort_by_degree(size_t *nodes, size_t count, const size_t *degree)
+{
+    // Сортировка вставками -- у строк разреженной матрицы мало соседей
+    for (size_t i = 1; i < count; i++) {
+        size_t node = nodes[i];
+        size_t j = i;
+        for (; j > 0 && degree[nodes[j - 1]] > degree[node]; j--) {
+            nodes[j] = nodes[j - 1];
+        }
+        nodes[j] = node;
+    }
+}
+
+size_t *sparse_rcm_order(SparseMatrix *matrix, int *status) {
+    if (matrix == NULL || matrix->row != matrix->col) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = matrix->row;
+    // Обратный алгоритм Катхилла-Макки строится по симметричному шаблону A + A^T
+    SparseMatrix *t = sparse_transpose(matrix, status);
+    if (t == NULL) {
+        return NULL;
+    }
+    size_t *adj_start = calloc(n + 1, sizeof(*adj_start));
+    size_t *adj = malloc((2 * matrix->nnz != 0 ? 2 * matrix->nnz : 1) * sizeof(*adj));
+    size_t *degree = malloc((n != 0 ? n : 1) * sizeof(*degree));
+    size_t *order = malloc((n != 0 ? n : 1) * sizeof(*order));
+    _Bool *visited = calloc(n != 0 ? n : 1, sizeof(*visited));
+    if (adj_start == NULL || adj == NULL || degree == NULL || order == NULL || visited == NULL) {
+        *status = ALLOC_FAILED;
+        free_sparse_matrix(t);
+        free(adj_start);
+        free(adj);
+        free(degree);
+        free(order);
+        free(visited);
+        return NULL;
+    }
+
+    // Соседи вершины i -- объединение упорядоченных строк i матриц A и A^T без диагонали
+    for (size_t i = 0; i < n; i++) {
+        size_t p = matrix->row_start[i], q = t->row_start[i];
+        size_t count = 0;
+        while (p < matrix->row_start[i + 1] || q < t->row_start[i + 1]) {
+            size_t next;
+            if (q >= t->row_start[i + 1] || (p < matrix->row_start[i + 1] && matrix->col_idx[p] < t->col_idx[q])) {
+                next = matrix->col_idx[p++];
+            } else if (p >= matrix->row_start[i + 1] || t->col_idx[q] < matrix->col_idx[p]) {
+                next = t->col_idx[q++];
+            } else {
+                next = matrix->col_idx[p++];
+                q++;
+            }
+            if (next != i) {
+                adj[adj_start[i] + count++] = next;
+            }
+        }
+        degree[i] = count;
+        adj_start[i + 1] = adj_start[i] + count;
+    }
+    free_sparse_matrix(t);
+
+    // Вершины, упорядоченные по степени, -- кандидаты в начальные вершины обхода компонент связности
+    size_t *by_degree = malloc((n != 0 ? n : 1) * sizeof(*by_degree));
+    size_t *counter = calloc(n + 1, sizeof(*counter));
+    if (by_degree == NULL || counter == NULL) {
+        *status = ALLOC_FAILED;
+        free(by_degree);
+        free(counter);
+        free(adj_start);
+        free(adj);
+        free(degree);
+        free(order);
+        free(visited);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        counter[degree[i] + 1]++;
+    }
+    for (size_t d = 0; d < n; d++) {
+        counter[d + 1] += counter[d];
+    }
+    for (size_t i = 0; i < n; i++) {
+        by_degree[counter[degree[i]]++] = i;
+    }
+    free(counter);
+
+    // Обход в ширину из вершины минимальной степени для каждой компоненты связности, соседи добавляются
+    // в порядке возрастания степени
+    size_t head = 0, tail = 0, candidate = 0;
+    while (tail < n) {
+        while (visited[by_degree[candidate]]) {
+            candidate++;
+        }
+        size_t start = by_degree[candidate];
+        visited[start] = 1;
+        order[tail++] = start;
+        while (head < tail) {
+            size_t node = order[head++];
+            size_t first = tail;
+            for (size_t k = adj_start[node]; k < adj_start[node + 1]; k++) {
+                if (!visited[adj[k]]) {
+                    visited[adj[k]] = 1;
+                    order[tail++] = adj[k];
+                }
+            }
+            sort_by_degree(order + first, tail - first, degree);
+        }
+    }
+
+    // Обращение порядка уменьшает заполнение при исключении
+    for (size_t i = 0; i < n / 2; i++) {
+        size_t tmp = order[i];
+        order[i] = order[n - 1 - i];
+        order[n - 1 - i] = tmp;
+    }
+
+    free(by_degree);
+    free(adj_start);
+    free(adj);
+    free(degree);
+    free(visited);
+    *status = OK;
+    return order;
+}
@@ -0,0 +1,34 @@
+#ifndef LE_SOLVER_SPARSE_H
+#define LE_SOLVER_SPARSE_H
+
+#include "matrix.h"
+
+// Разреженная матрица в формате CSR: ненулевые элементы строки i хранятся в values[row_start[i]..row_start[i+1])
+// в порядке возрастания номеров столбцов col_idx
+typedef struct {
+    size_t row;
+    size_t col;
+    size_t nnz;
+    size_t *row_start;
+    size_t *col_idx;
+    data_t *values;
+} SparseMatrix;
+
+SparseMatrix *new_sparse_matrix(size_t row, size_t col, size_t nnz);
+
+void free_sparse_matrix(SparseMatrix *matrix);
+
+SparseMatrix *copy_sparse_matrix(SparseMatrix *matrix);
+
+SparseMatrix *sparse_from_triplets(size_t row, size_t col, size_t count, const size_t *rows, const size_t *cols,
+                                   const data_t *values, int *status);
+
+SparseMatrix *sparse_from_dense(Matrix *matrix, int *status);
+
+SparseMatrix *sparse_transpose(SparseMatrix *matrix, int *status);
+
+void sparse_mul_vector(SparseMatrix *matrix, const data_t *x, data_t *y);
+
+size_t *sparse_rcm_order(SparseMatrix *matrix, int *status);
+
+#endif //LE_SOLVER_SPARSE_H
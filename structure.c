@@ -0,0 +1,191 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "structure.h"
+#include "band.h"
+#include "error.h"
+#include "profile.h"
+
+// Ленточное разложение выгоднее плотного, пока ширина ленты меньше этой доли размера матрицы. Прогонка выгоднее
+// при любом размере
+#define BAND_RATIO 4
+
+MatrixStructure detect_structure(Matrix *a) {
+    PROFILE_BEGIN("detect_structure");
+    MatrixStructure structure = {STRUCTURE_DENSE, 0, 0};
+    if (a == NULL || a->row != a->col) {
+        return structure;
+    }
+    size_t n = a->row;
+    for (size_t i = 0; i < n; i++) {
+        // Крайние ненулевые элементы строки ищутся с концов, поэтому для ленточной матрицы просматривается только
+        // лента и уже известная ширина ленты
+        for (size_t j = 0; j < i && i - j > structure.lower; j++) {
+            if (fabs(get_element(a, i, j)) > 0.0) {
+                structure.lower = i - j;
+                break;
+            }
+        }
+        for (size_t j = n - 1; j > i && j - i > structure.upper; j--) {
+            if (fabs(get_element(a, i, j)) > 0.0) {
+                structure.upper = j - i;
+                break;
+            }
+        }
+        size_t width = structure.lower + structure.upper;
+        if (structure.lower > 0 && structure.upper > 0 && width > 2 && BAND_RATIO * width >= n) {
+            PROFILE_COUNT(0, (i + 1) * n * sizeof(data_t), 0);
+            return structure;
+        }
+    }
+    PROFILE_COUNT(0, n * n * sizeof(data_t), 0);
+
+    if (structure.lower == 0 && structure.upper == 0) {
+        structure.type = STRUCTURE_DIAGONAL;
+    } else if (structure.lower == 0) {
+        structure.type = STRUCTURE_UPPER_TRIANGULAR;
+    } else if (structure.upper == 0) {
+        structure.type = STRUCTURE_LOWER_TRIANGULAR;
+    } else if (structure.lower == 1 && structure.upper == 1) {
+        structure.type = STRUCTURE_TRIDIAGONAL;
+    } else {
+        structure.type = STRUCTURE_BANDED;
+    }
+    return structure;
+}
+
+const char *structure_name(int type) {
+    switch (type) {
+        case STRUCTURE_DIAGONAL:
+            return "диагональная";
+        case STRUCTURE_TRIDIAGONAL:
+            return "трёхдиагональная";
+        case STRUCTURE_BANDED:
+            return "ленточная";
+        case STRUCTURE_LOWER_TRIANGULAR:
+            return "нижнетреугольная";
+        case STRUCTURE_UPPER_TRIANGULAR:
+            return "верхнетреугольная";
+        default:
+            return "плотная";
+    }
+}
+
+static void triangular_solve(Matrix *a, MatrixStructure *structure, Matrix *answ)
+{
+    PROFILE_BEGIN("triangular_solve");
+    size_t n = a->row;
+    PROFILE_COUNT(2 * n * (structure->lower + structure->upper + 1) * answ->col, 0, 0);
+    // Подстановка в порядке, при котором все неизвестные строки, кроме диагональной, уже найдены. Вне ленты
+    // элементы нулевые и не просматриваются
+    for (size_t k = 0; k < n; k++) {
+        size_t row = structure->type == STRUCTURE_LOWER_TRIANGULAR ? k : n - 1 - k;
+        size_t first = row > structure->lower ? row - structure->lower : 0;
+        size_t last = row + structure->upper < n - 1 ? row + structure->upper : n - 1;
+        for (size_t j = first; j <= last; j++) {
+            if (j != row) {
+                mul_sub_row(answ, j, row, -get_element(a, row, j));
+            }
+        }
+        mul_row(answ, row, 1.0 / get_element(a, row, row));
+    }
+}
+
+// Метод прогонки устойчив без выбора главного элемента при диагональном преобладании
+static _Bool diagonally_dominant(Matrix *a)
+{
+    size_t n = a->row;
+    for (size_t i = 0; i < n; i++) {
+        data_t off_diagonal = (i > 0 ? fabs(get_element(a, i, i - 1)) : 0.0) +
+                              (i + 1 < n ? fabs(get_element(a, i, i + 1)) : 0.0);
+        if (!(fabs(get_element(a, i, i)) >= off_diagonal) || !(fabs(get_element(a, i, i)) > 0.0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int thomas_solve(Matrix *a, Matrix *answ)
+{
+    PROFILE_BEGIN("thomas_solve");
+    size_t n = a->row;
+    data_t *upper = malloc((n != 0 ? n : 1) * sizeof(*upper)); // Наддиагональ после прямого хода
+    if (upper == NULL) {
+        return ALLOC_FAILED;
+    }
+    PROFILE_COUNT(n * (3 + 5 * answ->col), 0, 0);
+
+    // Прямой ход: b'_i = b_i - a_i * c'_(i-1), c'_i = c_i / b'_i, d'_i = (d_i - a_i * d'_(i-1)) / b'_i
+    for (size_t i = 0; i < n; i++) {
+        data_t diagonal = get_element(a, i, i);
+        if (i > 0) {
+            data_t sub = get_element(a, i, i - 1);
+            diagonal -= sub * upper[i - 1];
+            mul_sub_row(answ, i - 1, i, -sub);
+        }
+        upper[i] = i + 1 < n ? get_element(a, i, i + 1) / diagonal : 0.0;
+        mul_row(answ, i, 1.0 / diagonal);
+    }
+    // Обратный ход: x_i = d'_i - c'_i * x_(i+1)
+    for (size_t i = n - 1; i > 0; i--) {
+        mul_sub_row(answ, i, i - 1, -upper[i - 1]);
+    }
+
+    free(upper);
+    return OK;
+}
+
+static int band_dense_solve(Matrix *a, MatrixStructure *structure, Matrix *answ)
+{
+    PROFILE_BEGIN("band_solve");
+    size_t n = a->row;
+    BandMatrix *band = new_band_matrix(n, structure->lower, structure->upper);
+    if (band == NULL) {
+        return ALLOC_FAILED;
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t first = i > structure->lower ? i - structure->lower : 0;
+        size_t last = i + structure->upper < n - 1 ? i + structure->upper : n - 1;
+        for (size_t j = first; j <= last; j++) {
+            set_band_element(band, i, j, get_element(a, i, j));
+        }
+    }
+    PROFILE_COUNT(2 * n * structure->lower * (structure->lower + structure->upper + answ->col), 0, 0);
+
+    band_factor(band);
+    band_solve(band, answ);
+    free_band_matrix(band);
+    return OK;
+}
+
+Matrix *structured_solve(Matrix *a, Matrix *f, MatrixStructure *structure, int *status) {
+    PROFILE_BEGIN("structured_solve");
+    if (a == NULL || f == NULL || structure == NULL || a->row != a->col || f->row != a->row ||
+        structure->type == STRUCTURE_DENSE) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Matrix *answ = copy_matrix(f); // Все способы преобразуют правую часть на месте
+    if (answ == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+
+    *status = OK;
+    if (structure->type == STRUCTURE_DIAGONAL) {
+        for (size_t i = 0; i < a->row; i++) {
+            mul_row(answ, i, 1.0 / get_element(a, i, i));
+        }
+    } else if (structure->type == STRUCTURE_LOWER_TRIANGULAR || structure->type == STRUCTURE_UPPER_TRIANGULAR) {
+        triangular_solve(a, structure, answ);
+    } else if (structure->type == STRUCTURE_TRIDIAGONAL && diagonally_dominant(a)) {
+        *status = thomas_solve(a, answ);
+    } else { // Трёхдиагональная матрица без преобладания решается ленточным разложением с выбором главного элемента
+        *status = band_dense_solve(a, structure, answ);
+    }
+    if (*status != OK) {
+        free_matrix(answ);
+        return NULL;
+    }
+    return answ;
+}
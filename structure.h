@@ -0,0 +1,31 @@
+#ifndef LE_SOLVER_STRUCTURE_H
+#define LE_SOLVER_STRUCTURE_H
+
+#include "matrix.h"
+
+// Виды структуры матрицы, для которых решение системы не требует разложения всей матрицы
+enum {
+    STRUCTURE_DENSE = 0,
+    STRUCTURE_DIAGONAL,
+    STRUCTURE_TRIDIAGONAL,
+    STRUCTURE_BANDED,
+    STRUCTURE_LOWER_TRIANGULAR,
+    STRUCTURE_UPPER_TRIANGULAR
+};
+
+typedef struct {
+    int type;
+    size_t lower; // Число ненулевых поддиагоналей
+    size_t upper; // Число ненулевых наддиагоналей
+} MatrixStructure;
+
+// Определяет ширину ленты за один проход по строкам, просмотр прекращается, как только матрица оказывается плотной
+MatrixStructure detect_structure(Matrix *a);
+
+const char *structure_name(int type);
+
+// Решает систему способом, соответствующим структуре: делением на диагональ, методом прогонки, разложением в
+// ленточном формате или подстановкой. Для плотной структуры возвращает NULL со статусом INCORRECT_ARGS
+Matrix *structured_solve(Matrix *a, Matrix *f, MatrixStructure *structure, int *status);
+
+#endif //LE_SOLVER_STRUCTURE_H
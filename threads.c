@@ -0,0 +1,41 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "threads.h"
+
+// 0 -- число потоков ещё не определено. Значение читается из потоков пакетного режима и сервера, а повторное
+// определение даёт тот же результат, поэтому достаточно атомарных операций без упорядочивания
+static _Atomic size_t thread_count = 0;
+
+size_t get_thread_count(void) {
+    size_t current = atomic_load_explicit(&thread_count, memory_order_relaxed);
+    if (current == 0) {
+        // Число потоков задаётся переменной окружения LE_SOLVER_THREADS, иначе используются все доступные ядра
+        const char *env = getenv("LE_SOLVER_THREADS");
+        size_t count = env != NULL ? strtoul(env, NULL, 0) : 0;
+#ifdef _OPENMP
+        if (count == 0) {
+            count = (size_t) omp_get_max_threads();
+        }
+#endif
+        current = count != 0 ? count : 1;
+        atomic_store_explicit(&thread_count, current, memory_order_relaxed);
+    }
+    return current;
+}
+
+void set_thread_count(size_t count) {
+    atomic_store_explicit(&thread_count, count, memory_order_relaxed); // 0 сбрасывает значение к заданному окружением
+}
+
+size_t get_thread_index(void) {
+#ifdef _OPENMP
+    return (size_t) omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef LE_SOLVER_THREADS_H
+#define LE_SOLVER_THREADS_H
+
+#include <stddef.h>
+
+// Минимальный объём работы (число обновляемых элементов), начиная с которого цикл выполняется параллельно
+#define PARALLEL_THRESHOLD 32768
+
+// Без OpenMP аргументы не вычисляются, поэтому значения для предложений вроде num_threads(get_thread_count())
+// записываются прямо в них, а не сохраняются в локальные переменные, которые тогда оказались бы неиспользуемыми
+#ifdef _OPENMP
+#define PRAGMA(x) _Pragma(#x)
+#define PARALLEL_FOR(...) PRAGMA(omp parallel for __VA_ARGS__)
+#else
+#define PARALLEL_FOR(...)
+#endif
+
+size_t get_thread_count(void);
+
+void set_thread_count(size_t count);
+
+size_t get_thread_index(void);
+
+#endif //LE_SOLVER_THREADS_H
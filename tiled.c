@@ -0,0 +1,407 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tiled.h"
+#include "error.h"
+#include "threads.h"
+#include "profile.h"
+
+#define TILE_SIZE(store) ((store)->tile * (store)->tile * sizeof(data_t))
+#define TILE_OFFSET(store, row, col) ((off_t) (((col) * (store)->tiles + (row)) * TILE_SIZE(store)))
+
+static int read_range(int fd, void *buffer, size_t size, off_t offset)
+{
+    unsigned char *pos = buffer;
+    while (size > 0) {
+        ssize_t done = pread(fd, pos, size, offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return INCORRECT_ARGS;
+        }
+        pos += done;
+        size -= (size_t) done;
+        offset += done;
+    }
+    return OK;
+}
+
+static int write_range(int fd, const void *buffer, size_t size, off_t offset)
+{
+    const unsigned char *pos = buffer;
+    while (size > 0) {
+        ssize_t done = pwrite(fd, pos, size, offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return INCORRECT_ARGS;
+        }
+        pos += done;
+        size -= (size_t) done;
+        offset += done;
+    }
+    return OK;
+}
+
+TileStore *new_tile_store(const char *path, size_t n, size_t tile, int *status) {
+    if (path == NULL || tile == 0) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    TileStore *store = malloc(sizeof(*store));
+    if (store == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    store->n = n;
+    store->tile = tile;
+    store->tiles = (n + tile - 1) / tile;
+    if ((store->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0 ||
+        ftruncate(store->fd, TILE_OFFSET(store, 0, store->tiles)) != 0) {
+        *status = INCORRECT_ARGS;
+        free_tile_store(store);
+        return NULL;
+    }
+    *status = OK;
+    return store;
+}
+
+void free_tile_store(TileStore *store) {
+    if (store == NULL) {
+        return;
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    free(store);
+}
+
+int tile_store_read(TileStore *store, size_t row, size_t col, data_t *tile) {
+    return read_range(store->fd, tile, TILE_SIZE(store), TILE_OFFSET(store, row, col));
+}
+
+int tile_store_write(TileStore *store, size_t row, size_t col, const data_t *tile) {
+    return write_range(store->fd, tile, TILE_SIZE(store), TILE_OFFSET(store, row, col));
+}
+
+// Панель -- столбец плиток, в памяти это матрица (tiles * tile) x tile по строкам, т.е. строка p матрицы
+// начинается с panel + p * tile
+static int read_panel(TileStore *store, size_t col, data_t *panel)
+{
+    return read_range(store->fd, panel, store->tiles * TILE_SIZE(store), TILE_OFFSET(store, 0, col));
+}
+
+static int write_panel(TileStore *store, size_t col, const data_t *panel)
+{
+    return write_range(store->fd, panel, store->tiles * TILE_SIZE(store), TILE_OFFSET(store, 0, col));
+}
+
+static data_t *new_panel(TileStore *store)
+{
+    return aligned_alloc(MATRIX_ALIGNMENT, MATRIX_ALIGN_UP(store->tiles * TILE_SIZE(store) + 1));
+}
+
+// Чтение плитки заранее: ядро начинает чтение в страничный кэш и продолжает его, пока обрабатывается текущая
+static void prefetch_tile(TileStore *store, size_t row, size_t col)
+{
+    if (row < store->tiles && col < store->tiles) {
+        posix_fadvise(store->fd, TILE_OFFSET(store, row, col), (off_t) TILE_SIZE(store), POSIX_FADV_WILLNEED);
+    }
+}
+
+int tile_store_fill(TileStore *store, Operator *a) {
+    PROFILE_BEGIN("tile_store_fill");
+    if (store == NULL || a == NULL || a->element == NULL || a->n != store->n) {
+        return INCORRECT_ARGS;
+    }
+    data_t *panel = new_panel(store);
+    if (panel == NULL) {
+        return ALLOC_FAILED;
+    }
+    size_t t = store->tile;
+    int status = OK;
+    for (size_t col = 0; col < store->tiles && status == OK; col++) {
+        for (size_t i = 0; i < store->tiles * t; i++) {
+            for (size_t c = 0; c < t; c++) {
+                size_t j = col * t + c;
+                panel[i * t + c] = i < store->n && j < store->n ? a->element(a->context, i, j) : 0.0;
+            }
+        }
+        status = write_panel(store, col, panel);
+    }
+    free(panel);
+    return status;
+}
+
+// Строка dst_row матрицы dst увеличивается на строку src_row матрицы src, умноженную на c
+static void sub_scaled_row(Matrix *dst, size_t dst_row, Matrix *src, size_t src_row, data_t c)
+{
+    for (size_t j = 0; j < dst->col; j++) {
+        set_element(dst, dst_row, j, get_element(dst, dst_row, j) + c * get_element(src, src_row, j));
+    }
+}
+
+void free_tiled_lu(TiledLU *factor) {
+    if (factor == NULL) {
+        return;
+    }
+    free(factor->pivots);
+    free(factor->steps);
+    free(factor->diagonal_blocks);
+    free(factor);
+}
+
+// Есть ли в плитке строки, у которых шаг не меньше first_step, т.е. которые затрагивает обработка плитки
+static _Bool tile_has_rows(TiledLU *factor, size_t row, size_t first_step)
+{
+    TileStore *store = factor->store;
+    for (size_t p = row * store->tile; p < (row + 1) * store->tile && p < store->n; p++) {
+        if (factor->steps[p] >= first_step) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Обновление панели предыдущей панелью block: A_J = A_J - L_(*, K) * U_(K, J)
+static int update_panel(TiledLU *factor, size_t block, data_t *panel, data_t *tile)
+{
+    PROFILE_BEGIN("tiled_update_panel");
+    TileStore *store = factor->store;
+    size_t t = store->tile, base = block * t;
+    const data_t *diagonal = factor->diagonal_blocks + block * t * t;
+
+    // Строки U блока: прямая подстановка с диагональным блоком L в порядке шагов
+    for (size_t kk = 0; kk < t; kk++) {
+        data_t *u_row = panel + factor->pivots[base + kk] * t;
+        for (size_t k = 0; k < kk; k++) {
+            const data_t *prev_row = panel + factor->pivots[base + k] * t;
+            for (size_t c = 0; c < t; c++) {
+                u_row[c] -= diagonal[kk * t + k] * prev_row[c];
+            }
+        }
+    }
+
+    for (size_t row = 0; row < store->tiles; row++) {
+        if (!tile_has_rows(factor, row, base + t)) {
+            continue; // Все строки плитки стали главными не позже блока, множителей L в ней нет
+        }
+        int status = tile_store_read(store, row, block, tile);
+        if (status != OK) {
+            return status;
+        }
+        // Следующая плитка панели или, после последней, первая плитка следующей панели
+        prefetch_tile(store, row + 1 < store->tiles ? row + 1 : 0, row + 1 < store->tiles ? block : block + 1);
+
+        PARALLEL_FOR(num_threads(get_thread_count()) if(t * t * t > PARALLEL_THRESHOLD) schedule(static))
+        for (size_t r = 0; r < t; r++) {
+            size_t p = row * t + r;
+            if (p >= store->n || factor->steps[p] < base + t) {
+                continue;
+            }
+            data_t *a_row = panel + p * t;
+            for (size_t kk = 0; kk < t; kk++) {
+                data_t l = tile[r * t + kk];
+                const data_t *u_row = panel + factor->pivots[base + kk] * t;
+                for (size_t c = 0; c < t; c++) {
+                    a_row[c] -= l * u_row[c];
+                }
+            }
+        }
+        PROFILE_COUNT(2 * t * t * t, TILE_SIZE(store), 0);
+    }
+    return OK;
+}
+
+// Разложение панели по строкам, которые ещё не стали главными
+static int factor_panel(TiledLU *factor, size_t block, data_t *panel)
+{
+    PROFILE_BEGIN("tiled_factor_panel");
+    TileStore *store = factor->store;
+    size_t n = store->n, t = store->tile, base = block * t;
+    for (size_t kk = 0; kk < t && base + kk < n; kk++) {
+        size_t pivot = n;
+        for (size_t p = 0; p < n; p++) {
+            if (factor->steps[p] == n && (pivot == n || fabs(panel[p * t + kk]) > fabs(panel[pivot * t + kk]))) {
+                pivot = p;
+            }
+        }
+        const data_t *pivot_row = panel + pivot * t;
+        if (!(fabs(pivot_row[kk]) > 0.0)) { // Матрица вырождена
+            return INCORRECT_ARGS;
+        }
+        factor->steps[pivot] = base + kk;
+        factor->pivots[base + kk] = pivot;
+
+        PARALLEL_FOR(num_threads(get_thread_count()) if(n * (t - kk) > PARALLEL_THRESHOLD) schedule(static))
+        for (size_t p = 0; p < n; p++) {
+            if (factor->steps[p] != n) {
+                continue;
+            }
+            data_t *row = panel + p * t;
+            data_t l = row[kk] / pivot_row[kk];
+            row[kk] = l; // Множитель L сохраняется на месте занулённого элемента
+            for (size_t c = kk + 1; c < t; c++) {
+                row[c] -= l * pivot_row[c];
+            }
+        }
+        PROFILE_COUNT(2 * (n - base - kk) * (t - kk), 0, 0);
+    }
+
+    data_t *diagonal = factor->diagonal_blocks + block * t * t;
+    for (size_t kk = 0; kk < t; kk++) {
+        for (size_t c = 0; c < t; c++) {
+            diagonal[kk * t + c] = base + kk < n ? panel[factor->pivots[base + kk] * t + c] : 0.0;
+        }
+    }
+    return OK;
+}
+
+TiledLU *tiled_lu_factor(TileStore *store, int *status) {
+    PROFILE_BEGIN("tiled_lu_factor");
+    if (store == NULL) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = store->n, t = store->tile;
+    TiledLU *factor = calloc(1, sizeof(*factor));
+    data_t *panel = new_panel(store);
+    data_t *tile = aligned_alloc(MATRIX_ALIGNMENT, MATRIX_ALIGN_UP(TILE_SIZE(store)));
+    if (factor == NULL || panel == NULL || tile == NULL) {
+        *status = ALLOC_FAILED;
+        free(factor);
+        free(panel);
+        free(tile);
+        return NULL;
+    }
+    factor->store = store;
+    factor->pivots = malloc((n + 1) * sizeof(*factor->pivots));
+    factor->steps = malloc((n + 1) * sizeof(*factor->steps));
+    factor->diagonal_blocks = malloc((store->tiles * t * t + 1) * sizeof(*factor->diagonal_blocks));
+    if (factor->pivots == NULL || factor->steps == NULL || factor->diagonal_blocks == NULL) {
+        *status = ALLOC_FAILED;
+        free_tiled_lu(factor);
+        free(panel);
+        free(tile);
+        return NULL;
+    }
+    for (size_t p = 0; p < n; p++) {
+        factor->steps[p] = n; // Строка ещё не стала главной
+    }
+
+    *status = OK;
+    for (size_t block = 0; block < store->tiles && *status == OK; block++) {
+        *status = read_panel(store, block, panel);
+        prefetch_tile(store, 0, 0);
+        for (size_t k = 0; k < block && *status == OK; k++) {
+            *status = update_panel(factor, k, panel, tile);
+        }
+        if (*status == OK) {
+            *status = factor_panel(factor, block, panel);
+        }
+        if (*status == OK) {
+            *status = write_panel(store, block, panel);
+        }
+    }
+
+    free(panel);
+    free(tile);
+    if (*status != OK) {
+        free_tiled_lu(factor);
+        return NULL;
+    }
+    return factor;
+}
+
+Matrix *tiled_lu_solve(TiledLU *factor, Matrix *f, int *status) {
+    PROFILE_BEGIN("tiled_lu_solve");
+    if (factor == NULL || f == NULL || f->row != factor->store->n) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    TileStore *store = factor->store;
+    size_t n = store->n, t = store->tile, cols = f->col;
+    Matrix *b = copy_matrix(f); // Правая часть по физическим строкам
+    Matrix *y = new_matrix(n, cols); // Решение L * y = P * f в порядке шагов
+    Matrix *answ = new_matrix(n, cols);
+    data_t *tile = aligned_alloc(MATRIX_ALIGNMENT, MATRIX_ALIGN_UP(TILE_SIZE(store)));
+    if (b == NULL || y == NULL || answ == NULL || tile == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(b);
+        free_matrix(y);
+        free_matrix(answ);
+        free(tile);
+        return NULL;
+    }
+
+    // Прямой ход по панелям: y блока находится по диагональному блоку, затем вычитается из ещё не главных строк
+    *status = OK;
+    for (size_t block = 0; block < store->tiles && *status == OK; block++) {
+        size_t base = block * t, count = n - base < t ? n - base : t;
+        const data_t *diagonal = factor->diagonal_blocks + block * t * t;
+        for (size_t kk = 0; kk < count; kk++) {
+            for (size_t c = 0; c < cols; c++) {
+                data_t sum = get_element(b, factor->pivots[base + kk], c);
+                for (size_t k = 0; k < kk; k++) {
+                    sum -= diagonal[kk * t + k] * get_element(y, base + k, c);
+                }
+                set_element(y, base + kk, c, sum);
+            }
+        }
+        for (size_t row = 0; row < store->tiles && *status == OK; row++) {
+            if (!tile_has_rows(factor, row, base + count) || (*status = tile_store_read(store, row, block, tile)) != OK) {
+                continue;
+            }
+            prefetch_tile(store, row + 1, block);
+            for (size_t r = 0; r < t && row * t + r < n; r++) {
+                size_t p = row * t + r;
+                for (size_t kk = 0; kk < count && factor->steps[p] >= base + count; kk++) {
+                    sub_scaled_row(b, p, y, base + kk, -tile[r * t + kk]);
+                }
+            }
+        }
+    }
+
+    // Обратный ход по панелям справа налево: x блока находится по диагональному блоку U, затем вычитается из
+    // правых частей строк U предыдущих шагов
+    for (size_t block = store->tiles; block > 0 && *status == OK; block--) {
+        size_t base = (block - 1) * t, count = n - base < t ? n - base : t;
+        const data_t *diagonal = factor->diagonal_blocks + (block - 1) * t * t;
+        for (size_t kk = count; kk > 0; kk--) {
+            for (size_t c = 0; c < cols; c++) {
+                data_t sum = get_element(y, base + kk - 1, c);
+                for (size_t k = kk; k < count; k++) {
+                    sum -= diagonal[(kk - 1) * t + k] * get_element(answ, base + k, c);
+                }
+                set_element(answ, base + kk - 1, c, sum / diagonal[(kk - 1) * t + kk - 1]);
+            }
+        }
+        for (size_t row = 0; row < store->tiles && *status == OK; row++) {
+            if ((*status = tile_store_read(store, row, block - 1, tile)) != OK) {
+                continue;
+            }
+            prefetch_tile(store, row + 1, block - 1);
+            for (size_t r = 0; r < t && row * t + r < n; r++) {
+                size_t step = factor->steps[row * t + r];
+                for (size_t kk = 0; kk < count && step < base; kk++) {
+                    sub_scaled_row(y, step, answ, base + kk, -tile[r * t + kk]);
+                }
+            }
+        }
+    }
+
+    free_matrix(b);
+    free_matrix(y);
+    free(tile);
+    if (*status != OK) {
+        free_matrix(answ);
+        return NULL;
+    }
+    return answ;
+}
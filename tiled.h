@@ -0,0 +1,47 @@
+#ifndef LE_SOLVER_TILED_H
+#define LE_SOLVER_TILED_H
+
+#include "matrix.h"
+#include "operator.h"
+
+// Хранилище квадратной матрицы n x n в файле в виде квадратных плиток tile x tile, каждая по строкам. Плитки одного
+// столбца плиток (панели) идут в файле подряд, поэтому панель читается одним последовательным запросом. Плитки на
+// краю матрицы дополнены нулями
+typedef struct {
+    int fd;
+    size_t n;
+    size_t tile;
+    size_t tiles; // Число плиток по стороне матрицы
+} TileStore;
+
+// Создаёт или перезаписывает файл path, заполненный нулями
+TileStore *new_tile_store(const char *path, size_t n, size_t tile, int *status);
+
+void free_tile_store(TileStore *store);
+
+int tile_store_read(TileStore *store, size_t row, size_t col, data_t *tile);
+
+int tile_store_write(TileStore *store, size_t row, size_t col, const data_t *tile);
+
+// Заполняет хранилище элементами оператора, в памяти находится одна панель
+int tile_store_fill(TileStore *store, Operator *a);
+
+// LU-разложение с выбором главного элемента по столбцу, выполняемое на месте в хранилище. Строки физически не
+// переставляются: строка pivots[k] становится главной на шаге k и хранит строку k матрицы U, а строки, ставшие
+// главными позже, хранят множители L в столбцах предыдущих шагов
+typedef struct {
+    TileStore *store;
+    size_t *pivots;
+    size_t *steps; // Шаг, на котором строка стала главной
+    data_t *diagonal_blocks; // Диагональные блоки L и U в порядке шагов, по блоку tile x tile на панель
+} TiledLU;
+
+// Разложение по панелям слева направо (left-looking): панель обновляется всеми предыдущими, которые читаются по
+// одной плитке, после чего раскладывается. В памяти одновременно находятся панель, одна плитка и диагональные блоки
+TiledLU *tiled_lu_factor(TileStore *store, int *status);
+
+void free_tiled_lu(TiledLU *factor);
+
+Matrix *tiled_lu_solve(TiledLU *factor, Matrix *f, int *status);
+
+#endif //LE_SOLVER_TILED_H
@@ -0,0 +1,262 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "woodbury.h"
+#include "error.h"
+#include "threads.h"
+#include "profile.h"
+
+// Если отношение наименьшего по модулю главного элемента разложения I + V^T * Z к наибольшему меньше этого значения,
+// поправка считается неустойчивой и матрица раскладывается заново
+#define WOODBURY_PIVOT_RATIO 1e-8
+
+WoodburySolver *new_woodbury_solver(Matrix *a, size_t max_rank, int *status) {
+    PROFILE_BEGIN("new_woodbury_solver");
+    if (a == NULL || a->row != a->col) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    size_t n = a->row;
+    if (max_rank == 0) {
+        max_rank = n / 8 != 0 ? n / 8 : 1;
+    }
+    WoodburySolver *solver = malloc(sizeof(*solver));
+    if (solver == NULL) {
+        *status = ALLOC_FAILED;
+        return NULL;
+    }
+    solver->rank = 0;
+    solver->max_rank = max_rank;
+    solver->capacitance = NULL;
+    solver->refactorizations = 0;
+    solver->factor = NULL;
+    solver->a = copy_matrix(a);
+    solver->u = new_matrix(n, max_rank);
+    solver->v = new_matrix(n, max_rank);
+    solver->z = new_matrix(n, max_rank);
+    if (solver->a == NULL || solver->u == NULL || solver->v == NULL || solver->z == NULL) {
+        *status = ALLOC_FAILED;
+        free_woodbury_solver(solver);
+        return NULL;
+    }
+    if ((solver->factor = lu_factor(solver->a, 1, status)) == NULL) {
+        free_woodbury_solver(solver);
+        return NULL;
+    }
+
+    *status = OK;
+    return solver;
+}
+
+void free_woodbury_solver(WoodburySolver *solver) {
+    if (solver == NULL) {
+        return;
+    }
+    free_lu_factor(solver->capacitance);
+    free_lu_factor(solver->factor);
+    free_matrix(solver->z);
+    free_matrix(solver->v);
+    free_matrix(solver->u);
+    free_matrix(solver->a);
+    free(solver);
+}
+
+// Разложение текущей матрицы, после которого поправка становится нулевой
+static void refactor(WoodburySolver *solver, int *status)
+{
+    PROFILE_BEGIN("woodbury_refactor");
+    LUFactor *factor = lu_factor(solver->a, 1, status);
+    if (factor == NULL) {
+        return;
+    }
+    free_lu_factor(solver->factor);
+    free_lu_factor(solver->capacitance);
+    solver->factor = factor;
+    solver->capacitance = NULL;
+    solver->rank = 0;
+    solver->refactorizations++;
+}
+
+// Разложение I + V^T * Z. Возвращает 0, если разложение неустойчиво и нужно разложить A заново
+static _Bool factor_capacitance(WoodburySolver *solver, int *status)
+{
+    PROFILE_BEGIN("factor_capacitance");
+    size_t n = solver->a->row, rank = solver->rank;
+    PROFILE_COUNT(2 * n * rank * rank, 0, 0);
+    Matrix *c = new_matrix(rank, rank);
+    if (c == NULL) {
+        *status = ALLOC_FAILED;
+        return 1;
+    }
+    for (size_t i = 0; i < rank; i++) {
+        set_element(c, i, i, 1.0);
+    }
+    for (size_t k = 0; k < n; k++) { // Строки V и Z читаются последовательно
+        const data_t *v = solver->v->values + k * solver->v->stride;
+        const data_t *z = solver->z->values + k * solver->z->stride;
+        for (size_t i = 0; i < rank; i++) {
+            data_t *row = c->values + i * c->stride;
+            for (size_t j = 0; j < rank; j++) {
+                row[j] += v[i] * z[j];
+            }
+        }
+    }
+    free_lu_factor(solver->capacitance);
+    solver->capacitance = lu_factor(c, 1, status);
+    free_matrix(c);
+    if (solver->capacitance == NULL) {
+        return 1;
+    }
+
+    data_t min = INFINITY, max = 0.0;
+    for (size_t i = 0; i < rank; i++) {
+        data_t pivot = fabs(get_element(solver->capacitance->lu, i, solver->capacitance->col_order[i]));
+        min = pivot < min ? pivot : min;
+        max = pivot > max ? pivot : max;
+    }
+    return min >= WOODBURY_PIVOT_RATIO * max; // Ложно и для nan
+}
+
+void woodbury_update(WoodburySolver *solver, Matrix *u, Matrix *v, int *status) {
+    PROFILE_BEGIN("woodbury_update");
+    if (solver == NULL || u == NULL || v == NULL || u->row != solver->a->row || v->row != solver->a->row ||
+        u->col != v->col) {
+        *status = INCORRECT_ARGS;
+        return;
+    }
+    size_t n = solver->a->row, r = u->col;
+    PROFILE_COUNT(2 * n * n * r, 0, 0);
+    Matrix *z = NULL;
+    if (solver->rank + r <= solver->max_rank && (z = lu_solve(solver->factor, u, status)) == NULL) {
+        return;
+    }
+
+    PARALLEL_FOR(num_threads(get_thread_count()) if(n * n * r > PARALLEL_THRESHOLD) schedule(static))
+    for (size_t i = 0; i < n; i++) {
+        data_t *row = solver->a->values + i * solver->a->stride;
+        for (size_t k = 0; k < r; k++) {
+            data_t coefficient = get_element(u, i, k);
+            for (size_t j = 0; j < n; j++) {
+                row[j] += coefficient * get_element(v, j, k);
+            }
+        }
+    }
+    *status = OK;
+    if (z == NULL) { // Ранг поправки превысил бы max_rank
+        refactor(solver, status);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < r; k++) {
+            set_element(solver->u, i, solver->rank + k, get_element(u, i, k));
+            set_element(solver->v, i, solver->rank + k, get_element(v, i, k));
+            set_element(solver->z, i, solver->rank + k, get_element(z, i, k));
+        }
+    }
+    free_matrix(z);
+    solver->rank += r;
+    if (!factor_capacitance(solver, status) && *status == OK) {
+        refactor(solver, status);
+    }
+}
+
+void woodbury_update_row(WoodburySolver *solver, size_t row, Matrix *values, int *status) {
+    if (solver == NULL || values == NULL || row >= solver->a->row || values->row != 1 ||
+        values->col != solver->a->col) {
+        *status = INCORRECT_ARGS;
+        return;
+    }
+    // u = e_row, v -- разность новой и текущей строки
+    Matrix *u = new_matrix(solver->a->row, 1);
+    Matrix *v = new_matrix(solver->a->row, 1);
+    if (u == NULL || v == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(u);
+        free_matrix(v);
+        return;
+    }
+    set_element(u, row, 0, 1.0);
+    for (size_t j = 0; j < solver->a->col; j++) {
+        set_element(v, j, 0, get_element(values, 0, j) - get_element(solver->a, row, j));
+    }
+    woodbury_update(solver, u, v, status);
+    free_matrix(u);
+    free_matrix(v);
+}
+
+void woodbury_update_column(WoodburySolver *solver, size_t col, Matrix *values, int *status) {
+    if (solver == NULL || values == NULL || col >= solver->a->col || values->row != solver->a->row ||
+        values->col != 1) {
+        *status = INCORRECT_ARGS;
+        return;
+    }
+    // u -- разность нового и текущего столбца, v = e_col
+    Matrix *u = new_matrix(solver->a->row, 1);
+    Matrix *v = new_matrix(solver->a->row, 1);
+    if (u == NULL || v == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(u);
+        free_matrix(v);
+        return;
+    }
+    for (size_t i = 0; i < solver->a->row; i++) {
+        set_element(u, i, 0, get_element(values, i, 0) - get_element(solver->a, i, col));
+    }
+    set_element(v, col, 0, 1.0);
+    woodbury_update(solver, u, v, status);
+    free_matrix(u);
+    free_matrix(v);
+}
+
+Matrix *woodbury_solve(WoodburySolver *solver, Matrix *f, int *status) {
+    PROFILE_BEGIN("woodbury_solve");
+    if (solver == NULL || f == NULL || f->row != solver->a->row) {
+        *status = INCORRECT_ARGS;
+        return NULL;
+    }
+    Matrix *y = lu_solve(solver->factor, f, status);
+    size_t n = solver->a->row, rank = solver->rank;
+    if (y == NULL || rank == 0) {
+        return y;
+    }
+    PROFILE_COUNT(4 * n * rank * f->col, 0, 0);
+
+    Matrix *w = new_matrix(rank, f->col); // V^T * y
+    if (w == NULL) {
+        *status = ALLOC_FAILED;
+        free_matrix(y);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const data_t *v = solver->v->values + i * solver->v->stride;
+        const data_t *row = y->values + i * y->stride;
+        for (size_t k = 0; k < rank; k++) {
+            data_t *acc = w->values + k * w->stride;
+            for (size_t j = 0; j < f->col; j++) {
+                acc[j] += v[k] * row[j];
+            }
+        }
+    }
+    Matrix *t = lu_solve(solver->capacitance, w, status);
+    free_matrix(w);
+    if (t == NULL) {
+        free_matrix(y);
+        return NULL;
+    }
+
+    PARALLEL_FOR(num_threads(get_thread_count()) if(n * rank * f->col > PARALLEL_THRESHOLD) schedule(static))
+    for (size_t i = 0; i < n; i++) { // y -= Z * t
+        const data_t *z = solver->z->values + i * solver->z->stride;
+        data_t *row = y->values + i * y->stride;
+        for (size_t k = 0; k < rank; k++) {
+            const data_t *correction = t->values + k * t->stride;
+            for (size_t j = 0; j < f->col; j++) {
+                row[j] -= z[k] * correction[j];
+            }
+        }
+    }
+    free_matrix(t);
+    *status = OK;
+    return y;
+}
@@ -0,0 +1,41 @@
+#ifndef LE_SOLVER_WOODBURY_H
+#define LE_SOLVER_WOODBURY_H
+
+#include "matrix.h"
+#include "algs.h"
+
+// Решение систем с матрицей, изменяемой малоранговыми поправками: A = A0 + U * V^T, где A0 -- матрица на момент
+// последнего разложения. По формуле Шермана-Моррисона-Вудбери
+// A^-1 * f = y - Z * (I + V^T * Z)^-1 * V^T * y, где y = A0^-1 * f, Z = A0^-1 * U,
+// поэтому решение после поправки ранга k стоит O(n^2 + n * k) вместо O(n^3). Когда ранг превышает max_rank или
+// матрица I + V^T * Z становится близкой к вырожденной, A раскладывается заново, а поправка обнуляется
+typedef struct {
+    Matrix *a; // Текущая матрица системы
+    LUFactor *factor; // Разложение A0
+    size_t rank;
+    size_t max_rank;
+    Matrix *u; // Первые rank столбцов -- U, n x max_rank
+    Matrix *v;
+    Matrix *z; // A0^-1 * U
+    LUFactor *capacitance; // Разложение I + V^T * Z, NULL при нулевом ранге
+    size_t refactorizations; // Число повторных разложений
+} WoodburySolver;
+
+// При max_rank = 0 наибольший ранг поправки -- n / 8: дополнительная работа при решении не превышает половины
+// работы обратного хода, а повторное разложение окупается за max_rank поправок
+WoodburySolver *new_woodbury_solver(Matrix *a, size_t max_rank, int *status);
+
+void free_woodbury_solver(WoodburySolver *solver);
+
+// A += u * v^T, u и v -- матрицы n x r
+void woodbury_update(WoodburySolver *solver, Matrix *u, Matrix *v, int *status);
+
+// Замена строки row матрицы строкой values (1 x n)
+void woodbury_update_row(WoodburySolver *solver, size_t row, Matrix *values, int *status);
+
+// Замена столбца col матрицы столбцом values (n x 1)
+void woodbury_update_column(WoodburySolver *solver, size_t col, Matrix *values, int *status);
+
+Matrix *woodbury_solve(WoodburySolver *solver, Matrix *f, int *status);
+
+#endif //LE_SOLVER_WOODBURY_H